@@ -0,0 +1,74 @@
+#ifndef PRACTICA2MAR_ALIGNED_ALLOCATOR_HPP
+#define PRACTICA2MAR_ALIGNED_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+template<typename T, std::size_t Alignment = 64>
+struct aligned_allocator
+{
+    static_assert((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+    static_assert(Alignment >= alignof(T), "Alignment cannot be weaker than the natural alignment of T");
+
+    using value_type = T;
+    using pointer = T*;
+    using size_type = std::size_t;
+
+    template<typename U>
+    struct rebind
+    {
+        using other = aligned_allocator<U, Alignment>;
+    };
+
+    aligned_allocator() noexcept = default;
+
+    template<typename U>
+    aligned_allocator(const aligned_allocator<U, Alignment>&) noexcept
+    {}
+
+    pointer allocate(std::size_t count)
+    {
+        if(count == 0)
+            return nullptr;
+
+        void* ptr = nullptr;
+        std::size_t bytes = count * sizeof(T);
+
+#if defined(_MSC_VER)
+        ptr = _aligned_malloc(bytes, Alignment);
+#else
+        if(posix_memalign(&ptr, Alignment < sizeof(void*) ? sizeof(void*) : Alignment, bytes) != 0)
+            ptr = nullptr;
+#endif
+        if(ptr == nullptr)
+            throw std::bad_alloc{};
+
+        return static_cast<pointer>(ptr);
+    }
+
+    void deallocate(pointer ptr, std::size_t)
+    {
+#if defined(_MSC_VER)
+        _aligned_free(ptr);
+#else
+        std::free(ptr);
+#endif
+    }
+
+    friend bool operator==(const aligned_allocator&, const aligned_allocator&)
+    {
+        return true;
+    }
+
+    friend bool operator!=(const aligned_allocator&, const aligned_allocator&)
+    {
+        return false;
+    }
+};
+
+#endif //PRACTICA2MAR_ALIGNED_ALLOCATOR_HPP
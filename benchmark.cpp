@@ -0,0 +1,465 @@
+#define NDEBUG
+#include "graph.hpp"
+#include "csr_storage.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <algorithm>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware cache counters of the calling thread, read through perf_event_open. Where
+// the syscall is missing or not allowed (containers, paranoid kernels) available() is
+// false and the suite reports null counters.
+struct perf_counters
+{
+    perf_counters()
+    {
+#ifdef __linux__
+        _misses = _open(PERF_COUNT_HW_CACHE_MISSES, -1);
+        _references = _misses >= 0 ? _open(PERF_COUNT_HW_CACHE_REFERENCES, _misses) : -1;
+#endif
+    }
+
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    ~perf_counters()
+    {
+#ifdef __linux__
+        if(_references >= 0)
+            close(_references);
+        if(_misses >= 0)
+            close(_misses);
+#endif
+    }
+
+    bool available() const
+    {
+        return _misses >= 0 && _references >= 0;
+    }
+
+    void start()
+    {
+#ifdef __linux__
+        if(available())
+        {
+            ioctl(_misses, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(_misses, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    void stop()
+    {
+#ifdef __linux__
+        if(available())
+        {
+            ioctl(_misses, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            misses = _read(_misses);
+            references = _read(_references);
+        }
+#endif
+    }
+
+    std::uint64_t misses = 0;
+    std::uint64_t references = 0;
+
+private:
+#ifdef __linux__
+    static int _open(std::uint64_t config, int group)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = group < 0 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+    }
+
+    static std::uint64_t _read(int fd)
+    {
+        std::uint64_t value = 0;
+        return read(fd, &value, sizeof(value)) == sizeof(value) ? value : 0;
+    }
+#endif
+
+    int _misses = -1;
+    int _references = -1;
+};
+
+struct benchmark_node
+{};
+
+struct benchmark_result
+{
+    std::string name, storage;
+    std::size_t nodes, edges, ops;
+    float density;
+    double ns_per_op;
+    double bytes_per_edge;
+    bool counters;
+    std::uint64_t cache_misses, cache_references;
+};
+
+std::size_t storage_bytes(const adjacency_matrix& matrix)
+{
+    return matrix.capacity() * matrix.row_pitch() * sizeof(adjacency_matrix::word_t);
+}
+
+std::size_t storage_bytes(const csr_storage& csr)
+{
+    return (csr.offsets().size() + csr.targets().size()) * sizeof(std::size_t);
+}
+
+template<typename Storage>
+std::size_t edges_count(const Storage& storage)
+{
+    std::size_t count = 0;
+
+    for(auto edge : storage.edges())
+    {
+        (void)edge;
+        ++count;
+    }
+
+    return count;
+}
+
+// Same edges random_graph draws: density passes, each one arc per node
+std::vector<std::pair<std::size_t, std::size_t>> random_edges(std::size_t nodes, float density, std::uint64_t seed)
+{
+    std::vector<std::pair<std::size_t, std::size_t>> edges;
+    std::size_t passes = static_cast<std::size_t>(std::ceil(density));
+    edges.reserve(passes * nodes);
+
+    for(std::size_t i = 0; i < passes; ++i)
+    {
+        counter_rng prng{seed, i};
+
+        for(std::size_t j = 0; j < nodes; ++j)
+        {
+            std::size_t k = prng.below(nodes);
+
+            if(k != j)
+                edges.emplace_back(j, k);
+        }
+    }
+
+    return edges;
+}
+
+void freeze_storage(adjacency_matrix&)
+{}
+
+void freeze_storage(csr_storage& csr)
+{
+    csr.freeze();
+}
+
+template<typename Storage>
+Storage random_storage(std::size_t nodes, float density, std::uint64_t seed)
+{
+    Storage storage;
+    storage.add_nodes(nodes);
+    storage.add_edges(random_edges(nodes, density, seed));
+    freeze_storage(storage);
+    return storage;
+}
+
+struct benchmark_suite
+{
+    std::size_t repetitions = 3;
+    std::size_t max_matrix_nodes = 10000;
+    std::uint64_t seed = 42;
+
+    // body returns the number of operations it performed; the best repetition is kept.
+    // prepare runs before every repetition, outside the timed region.
+    void run(const std::string& name, const std::string& storage, std::size_t nodes, float density,
+             const std::function<std::size_t()>& setup_edges, const std::function<void()>& prepare,
+             const std::function<std::size_t()>& body, const std::function<std::size_t()>& bytes)
+    {
+        benchmark_result result{name, storage, nodes, setup_edges(), 0, density, 0.0, 0.0, false, 0, 0};
+        perf_counters counters;
+
+        for(std::size_t r = 0; r < repetitions; ++r)
+        {
+            prepare();
+            counters.start();
+            auto begin = std::chrono::steady_clock::now();
+            std::size_t ops = body();
+            auto end = std::chrono::steady_clock::now();
+            counters.stop();
+
+            double ns = std::chrono::duration<double, std::nano>(end - begin).count() / static_cast<double>(std::max<std::size_t>(ops, 1));
+
+            if(r == 0 || ns < result.ns_per_op)
+            {
+                result.ops = ops;
+                result.ns_per_op = ns;
+                result.counters = counters.available();
+                result.cache_misses = counters.misses;
+                result.cache_references = counters.references;
+            }
+        }
+
+        result.bytes_per_edge = result.edges ? static_cast<double>(bytes()) / static_cast<double>(result.edges) : 0.0;
+        std::clog << name << " [" << storage << ", n=" << nodes << ", density=" << density << "]: "
+                  << result.ns_per_op << " ns/op\n";
+        results.push_back(result);
+    }
+
+    void run(const std::string& name, const std::string& storage, std::size_t nodes, float density,
+             const std::function<std::size_t()>& setup_edges, const std::function<std::size_t()>& body,
+             const std::function<std::size_t()>& bytes)
+    {
+        run(name, storage, nodes, density, setup_edges, []{}, body, bytes);
+    }
+
+    template<typename Storage>
+    void storage_benchmarks(const std::string& storage_name, std::size_t nodes, float density)
+    {
+        auto edges = random_edges(nodes, density, seed);
+        Storage storage = random_storage<Storage>(nodes, density, seed);
+        std::size_t edges_in_storage = edges_count(storage);
+        auto edges_fn = [&]{ return edges_in_storage; };
+        auto bytes_fn = [&]{ return storage_bytes(storage); };
+
+        // Only the writes are timed: the empty storage is allocated beforehand
+        Storage fresh;
+
+        run("add_edges", storage_name, nodes, density, edges_fn, [&]
+        {
+            fresh = Storage{};
+            fresh.add_nodes(nodes);
+        }, [&]
+        {
+            fresh.add_edges(edges);
+            freeze_storage(fresh);
+            return edges.size();
+        }, bytes_fn);
+
+        run("neighbors", storage_name, nodes, density, edges_fn, [&]
+        {
+            std::size_t visited = 0, checksum = 0;
+
+            for(std::size_t i = 0; i < storage.nodes_count(); ++i)
+            {
+                for(std::size_t j : storage.neighbors(i))
+                {
+                    checksum += j;
+                    ++visited;
+                }
+            }
+
+            _sink = checksum;
+            return visited;
+        }, bytes_fn);
+
+        run("edges", storage_name, nodes, density, edges_fn, [&]
+        {
+            std::size_t visited = 0, checksum = 0;
+
+            for(auto edge : storage.edges())
+            {
+                checksum += edge.first ^ edge.second;
+                ++visited;
+            }
+
+            _sink = checksum;
+            return visited;
+        }, bytes_fn);
+    }
+
+    // Does not depend on the density, so it runs once per size
+    void node_benchmarks(std::size_t nodes)
+    {
+        run("add_node", "adjacency_matrix", nodes, 0.0f, [] { return std::size_t{0}; }, [&]
+        {
+            graph<benchmark_node> g;
+
+            for(std::size_t i = 0; i < nodes; ++i)
+                g.add_node();
+
+            return nodes;
+        }, [] { return std::size_t{0}; });
+    }
+
+    void graph_benchmarks(std::size_t nodes, float density)
+    {
+        graph<benchmark_node> last;
+        auto edges_fn = [&]{ return edges_count(last.adjacency()); };
+        auto bytes_fn = [&]{ return storage_bytes(last.adjacency()); };
+        // One op per arc random_graph draws
+        const std::size_t arcs = random_edges(nodes, density, seed).size();
+
+        last = random_graph<benchmark_node>(nodes, density, seed);
+
+        run("random_graph", "adjacency_matrix", nodes, density, edges_fn, [&]
+        {
+            last = random_graph<benchmark_node>(nodes, density, seed);
+            return arcs;
+        }, bytes_fn);
+    }
+
+    // One writer filling a directed matrix larger than the last level cache, through the
+    // proxy, through add_edges() and through a reference that sorts the arcs by word and
+    // folds their masks so every word is written once. The last one is what add_edges()
+    // would do if sorting paid off for a single writer.
+    void bulk_write_benchmarks(std::size_t nodes, float density)
+    {
+        auto edges = random_edges(nodes, density, seed);
+        adjacency_matrix matrix;
+        thread_pool single{1};
+        auto edges_fn = [&]{ return edges.size(); };
+        auto bytes_fn = [&]{ return storage_bytes(matrix); };
+        auto prepare = [&]{ matrix = adjacency_matrix{nodes, true}; };
+
+        run("bulk_write_proxy", "adjacency_matrix", nodes, density, edges_fn, prepare, [&]
+        {
+            for(const auto& edge : edges)
+                matrix(edge.first, edge.second) = true;
+
+            return edges.size();
+        }, bytes_fn);
+
+        run("bulk_write_add_edges", "adjacency_matrix", nodes, density, edges_fn, prepare, [&]
+        {
+            matrix.add_edges(edges, single);
+            return edges.size();
+        }, bytes_fn);
+
+        run("bulk_write_sorted", "adjacency_matrix", nodes, density, edges_fn, prepare, [&]
+        {
+            std::vector<std::uint64_t> arcs;
+            arcs.reserve(edges.size());
+
+            for(const auto& edge : edges)
+                arcs.push_back((std::uint64_t{edge.first} << 32) | edge.second);
+
+            std::sort(arcs.begin(), arcs.end());
+
+            for(std::size_t k = 0; k < arcs.size();)
+            {
+                const std::uint64_t word_key = arcs[k] >> 6;
+                bit_word mask = 0;
+
+                for(; k < arcs.size() && arcs[k] >> 6 == word_key; ++k)
+                    mask |= bit_mask(static_cast<std::size_t>(arcs[k] & 0xffffffffu));
+
+                matrix.row_words(static_cast<std::size_t>(word_key >> 26))[word_key & 0x3ffffffu] |= mask;
+            }
+
+            return edges.size();
+        }, bytes_fn);
+    }
+
+    void write_json(std::ostream& os) const
+    {
+        os << "{\n  \"context\": {\"repetitions\": " << repetitions << ", \"seed\": " << seed << "},\n"
+           << "  \"benchmarks\": [\n";
+
+        for(std::size_t i = 0; i < results.size(); ++i)
+        {
+            const benchmark_result& r = results[i];
+
+            os << "    {\"name\": \"" << r.name << "\", \"storage\": \"" << r.storage << "\""
+               << ", \"nodes\": " << r.nodes << ", \"density\": " << r.density
+               << ", \"edges\": " << r.edges << ", \"ops\": " << r.ops
+               << ", \"ns_per_op\": " << r.ns_per_op << ", \"bytes_per_edge\": " << r.bytes_per_edge;
+
+            if(r.counters)
+                os << ", \"cache_misses\": " << r.cache_misses << ", \"cache_references\": " << r.cache_references;
+            else
+                os << ", \"cache_misses\": null, \"cache_references\": null";
+
+            os << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+
+        os << "  ]\n}\n";
+    }
+
+    std::vector<benchmark_result> results;
+
+private:
+    static volatile std::size_t _sink;
+};
+
+volatile std::size_t benchmark_suite::_sink = 0;
+
+// Usage: benchmark [--out file.json] [--repetitions k] [--max-matrix-nodes n] [--bulk-nodes n]
+// The dense matrix needs n^2/8 bytes, so by default it stops at 10^4 nodes while
+// csr_storage covers the whole 10^3 - 10^5 range. The bulk write benchmarks use a
+// single 2^15 node matrix (128 MB), --bulk-nodes 0 skips them.
+int main(int argc, char** argv)
+{
+    benchmark_suite suite;
+    std::string out;
+    std::size_t bulk_nodes = std::size_t{1} << 15;
+
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        std::istringstream value{argv[i + 1]};
+
+        if(option == "--out")
+            out = argv[i + 1];
+        else if(option == "--repetitions")
+            value >> suite.repetitions;
+        else if(option == "--max-matrix-nodes")
+            value >> suite.max_matrix_nodes;
+        else if(option == "--bulk-nodes")
+            value >> bulk_nodes;
+        else
+        {
+            std::cerr << "Unknown option " << option << "\n";
+            return 1;
+        }
+    }
+
+    for(std::size_t nodes : {std::size_t{1000}, std::size_t{10000}, std::size_t{100000}})
+    {
+        if(nodes <= suite.max_matrix_nodes)
+            suite.node_benchmarks(nodes);
+
+        for(float density : {1.0f, 4.0f, 16.0f})
+        {
+            if(nodes <= suite.max_matrix_nodes)
+            {
+                suite.storage_benchmarks<adjacency_matrix>("adjacency_matrix", nodes, density);
+                suite.graph_benchmarks(nodes, density);
+            }
+
+            suite.storage_benchmarks<csr_storage>("csr_storage", nodes, density);
+        }
+    }
+
+    if(bulk_nodes > 0)
+    {
+        for(float density : {16.0f, 64.0f})
+            suite.bulk_write_benchmarks(bulk_nodes, density);
+    }
+
+    if(out.empty())
+        suite.write_json(std::cout);
+    else
+    {
+        std::ofstream file{out};
+        suite.write_json(file);
+    }
+}
@@ -0,0 +1,424 @@
+#ifndef PRACTICA2MAR_BFS_HPP
+#define PRACTICA2MAR_BFS_HPP
+
+#include <vector>
+#include <numeric>
+#include <array>
+
+#include "graph.hpp"
+#include "bit_row.hpp"
+#include "thread_pool.hpp"
+
+struct bfs_result
+{
+    std::vector<std::size_t> parent;
+    std::vector<std::size_t> depth;
+
+    bool reached(std::size_t node) const
+    {
+        return depth[node] != no_node;
+    }
+};
+
+struct bfs_options
+{
+    // Beamer's heuristic: go bottom-up once the frontier edges exceed unexplored/alpha,
+    // and back top-down once the frontier drops under nodes/beta
+    std::size_t alpha = 14;
+    std::size_t beta = 24;
+    std::size_t grain = 256;
+};
+
+namespace bfs_detail
+{
+    inline bool test(const std::vector<bit_word>& bits, std::size_t i)
+    {
+        return (atomic_load_word(&bits[i / bits_per_word]) & bit_mask(i)) != 0;
+    }
+
+    // Bottom-up steps scan the edges into each node, only possible when they are known
+    template<typename Storage>
+    auto bottom_up_capable(const Storage& storage, int) -> decltype(storage.tracks_in_edges())
+    {
+        return storage.tracks_in_edges();
+    }
+
+    template<typename Storage>
+    bool bottom_up_capable(const Storage& storage, long)
+    {
+        return !storage.directed();
+    }
+
+    // Sources of the edges into v for bottom-up steps, see bottom_up_capable()
+    template<typename Storage>
+    auto pull_neighbors(const Storage& storage, std::size_t v, int) -> decltype(storage.in_neighbors(v))
+    {
+        return storage.in_neighbors(v);
+    }
+
+    template<typename Storage>
+    auto pull_neighbors(const Storage& storage, std::size_t v, long) -> decltype(storage.neighbors(v))
+    {
+        return storage.neighbors(v);
+    }
+
+    // Bit k of a lane set stands for the k-th source of a multi-source batch
+    template<std::size_t Lanes>
+    using lane_set = std::array<bit_word, Lanes / bits_per_word>;
+
+    template<std::size_t Lanes>
+    bool any(const lane_set<Lanes>& lanes)
+    {
+        bit_word result = 0;
+
+        for(bit_word w : lanes)
+            result |= w;
+
+        return result != 0;
+    }
+
+    // Parent lookup of a bottom-up step: the first frontier node adjacent to v
+    template<typename Storage>
+    std::size_t frontier_parent(const Storage& storage, std::size_t v, const std::vector<bit_word>& frontier)
+    {
+        for(std::size_t u : storage.neighbors(v))
+            if((frontier[u / bits_per_word] & bit_mask(u)) != 0)
+                return u;
+
+        return no_node;
+    }
+
+    template<typename Observer>
+    std::size_t frontier_parent(const basic_adjacency_matrix<Observer>& matrix, std::size_t v, const std::vector<bit_word>& frontier)
+    {
+        bit_row row = matrix.in_row(v);
+
+        for(std::size_t w = 0; w < frontier.size(); ++w)
+        {
+            bit_word hits = row.data[w] & frontier[w];
+
+            if(hits != 0)
+                return w * bits_per_word + word_ctz(hits);
+        }
+
+        return no_node;
+    }
+}
+
+template<typename Storage>
+bfs_result bfs(const Storage& storage, std::size_t source, const bfs_options& options = {},
+               thread_pool& pool = thread_pool::default_pool())
+{
+    const std::size_t n = storage.nodes_count();
+    assert(source < n);
+
+    bfs_result result;
+    result.parent.assign(n, no_node);
+    result.depth.assign(n, no_node);
+    result.parent[source] = source;
+    result.depth[source] = 0;
+
+    std::vector<bit_word> visited(words_for_bits(n), 0), frontier_bits(words_for_bits(n), 0);
+    visited[source / bits_per_word] |= bit_mask(source);
+
+    std::vector<std::vector<std::size_t>> local_next(pool.size());
+    std::vector<std::size_t> local_scout(pool.size());
+    std::vector<std::size_t> frontier{source};
+
+    std::vector<std::size_t> degrees(pool.size(), 0);
+    pool.parallel_for(0, n, options.grain, [&](std::size_t worker, std::size_t b, std::size_t e)
+    {
+        for(std::size_t v = b; v < e; ++v)
+            degrees[worker] += storage.degree(v);
+    });
+
+    std::size_t unexplored = std::accumulate(degrees.begin(), degrees.end(), std::size_t{0});
+    std::size_t scout = storage.degree(source);
+    bool top_down = true;
+    const bool bottom_up = bfs_detail::bottom_up_capable(storage, 0);
+
+    for(std::size_t depth = 1; !frontier.empty(); ++depth)
+    {
+        if(top_down && bottom_up && scout > unexplored / options.alpha)
+            top_down = false;
+        else if(!top_down && frontier.size() < n / options.beta)
+            top_down = true;
+
+        unexplored -= std::min(unexplored, scout);
+
+        for(auto& next : local_next)
+            next.clear();
+        std::fill(local_scout.begin(), local_scout.end(), std::size_t{0});
+
+        if(top_down)
+        {
+            pool.parallel_for(0, frontier.size(), options.grain, [&](std::size_t worker, std::size_t b, std::size_t e)
+            {
+                for(std::size_t k = b; k < e; ++k)
+                {
+                    std::size_t u = frontier[k];
+
+                    for(std::size_t v : storage.neighbors(u))
+                    {
+                        if(bfs_detail::test(visited, v))
+                            continue;
+
+                        bit_word previous = atomic_fetch_or_word(&visited[v / bits_per_word], bit_mask(v));
+
+                        if((previous & bit_mask(v)) == 0)
+                        {
+                            result.parent[v] = u;
+                            result.depth[v] = depth;
+                            local_next[worker].push_back(v);
+                            local_scout[worker] += storage.degree(v);
+                        }
+                    }
+                }
+            });
+        }
+        else
+        {
+            std::fill(frontier_bits.begin(), frontier_bits.end(), bit_word{0});
+            for(std::size_t u : frontier)
+                frontier_bits[u / bits_per_word] |= bit_mask(u);
+
+            // Chunks are whole visited words, so every word has a single writer
+            std::size_t words = visited.size();
+            std::size_t grain = std::max<std::size_t>(options.grain / bits_per_word, 1);
+
+            pool.parallel_for(0, words, grain, [&](std::size_t worker, std::size_t b, std::size_t e)
+            {
+                for(std::size_t w = b; w < e; ++w)
+                {
+                    bit_word unvisited = ~visited[w];
+                    std::size_t end = std::min(n, (w + 1) * bits_per_word);
+
+                    for(std::size_t v = w * bits_per_word; v < end; ++v)
+                    {
+                        if((unvisited & bit_mask(v)) == 0)
+                            continue;
+
+                        std::size_t u = bfs_detail::frontier_parent(storage, v, frontier_bits);
+
+                        if(u != no_node)
+                        {
+                            visited[w] |= bit_mask(v);
+                            result.parent[v] = u;
+                            result.depth[v] = depth;
+                            local_next[worker].push_back(v);
+                            local_scout[worker] += storage.degree(v);
+                        }
+                    }
+                }
+            });
+        }
+
+        frontier.clear();
+        for(const auto& next : local_next)
+            frontier.insert(frontier.end(), next.begin(), next.end());
+
+        scout = std::accumulate(local_scout.begin(), local_scout.end(), std::size_t{0});
+    }
+
+    return result;
+}
+
+template<typename Node, typename Storage>
+bfs_result bfs(const graph<Node, Storage>& g, std::size_t source, const bfs_options& options = {},
+               thread_pool& pool = thread_pool::default_pool())
+{
+    return bfs(g.adjacency(), source, options, pool);
+}
+
+struct multi_source_bfs_options
+{
+    // Levels explored from every source, no_node for all of them
+    std::size_t max_depth = no_node;
+    // Bottom-up steps once a level has more than nodes/beta frontier nodes
+    std::size_t beta = 24;
+};
+
+// Multi-source BFS (Then et al., "The More the Merrier"): batches of Lanes sources are
+// explored together, with one bit per source in the lane set of every node, so a row is
+// scanned once per level for the whole batch and the frontier moves with word-wide ORs.
+// Batches run in parallel, one per worker, each with three lane sets per node. visit is
+// called as visit(source_index, node, depth) once per node reached from each source,
+// concurrently for different batches (hence different source indices).
+template<std::size_t Lanes = 64, typename Storage, typename Visitor>
+void multi_source_bfs(const Storage& storage, const std::vector<std::size_t>& sources, Visitor visit,
+                      const multi_source_bfs_options& options = {}, thread_pool& pool = thread_pool::default_pool())
+{
+    static_assert(Lanes > 0 && Lanes % bits_per_word == 0, "multi_source_bfs(): Lanes must be a multiple of 64");
+    using lanes_t = bfs_detail::lane_set<Lanes>;
+
+    const std::size_t n = storage.nodes_count();
+    const std::size_t batches = (sources.size() + Lanes - 1) / Lanes;
+    const bool bottom_up = bfs_detail::bottom_up_capable(storage, 0);
+
+    struct state
+    {
+        std::vector<lanes_t> seen, current, next;
+        std::vector<std::size_t> frontier, discovered;
+    };
+
+    // Sized once; every batch leaves its worker's lane sets cleared for the next one
+    std::vector<state> states(pool.size());
+
+    for(state& s : states)
+    {
+        s.seen.assign(n, lanes_t{});
+        s.current.assign(n, lanes_t{});
+        s.next.assign(n, lanes_t{});
+    }
+
+    pool.parallel_for(0, batches, 1, [&](std::size_t worker, std::size_t b, std::size_t e)
+    {
+        state& s = states[worker];
+
+        for(std::size_t batch = b; batch < e; ++batch)
+        {
+            const std::size_t first = batch * Lanes, count = std::min(Lanes, sources.size() - first);
+            lanes_t active{};
+            s.frontier.clear();
+
+            for(std::size_t lane = 0; lane < count; ++lane)
+            {
+                std::size_t source = sources[first + lane];
+                assert(source < n);
+                active[lane / bits_per_word] |= bit_mask(lane);
+
+                if(!bfs_detail::any<Lanes>(s.current[source]))
+                    s.frontier.push_back(source);
+
+                s.seen[source][lane / bits_per_word] |= bit_mask(lane);
+                s.current[source][lane / bits_per_word] |= bit_mask(lane);
+                visit(first + lane, source, std::size_t{0});
+            }
+
+            for(std::size_t depth = 1; !s.frontier.empty() && depth <= options.max_depth; ++depth)
+            {
+                s.discovered.clear();
+
+                if(bottom_up && s.frontier.size() > n / options.beta)
+                {
+                    // Every node ORs the lanes of its in-neighbors, until all its unseen lanes are found
+                    for(std::size_t v = 0; v < n; ++v)
+                    {
+                        lanes_t unseen, found{};
+
+                        for(std::size_t w = 0; w < unseen.size(); ++w)
+                            unseen[w] = active[w] & ~s.seen[v][w];
+
+                        if(!bfs_detail::any<Lanes>(unseen))
+                            continue;
+
+                        for(std::size_t u : bfs_detail::pull_neighbors(storage, v, 0))
+                        {
+                            for(std::size_t w = 0; w < found.size(); ++w)
+                                found[w] |= s.current[u][w] & unseen[w];
+
+                            if(found == unseen)
+                                break;
+                        }
+
+                        if(bfs_detail::any<Lanes>(found))
+                        {
+                            s.next[v] = found;
+                            s.discovered.push_back(v);
+                        }
+                    }
+                }
+                else
+                {
+                    for(std::size_t u : s.frontier)
+                    {
+                        for(std::size_t v : storage.neighbors(u))
+                        {
+                            bool was_empty = !bfs_detail::any<Lanes>(s.next[v]);
+
+                            for(std::size_t w = 0; w < Lanes / bits_per_word; ++w)
+                                s.next[v][w] |= s.current[u][w] & ~s.seen[v][w];
+
+                            if(was_empty && bfs_detail::any<Lanes>(s.next[v]))
+                                s.discovered.push_back(v);
+                        }
+                    }
+                }
+
+                for(std::size_t u : s.frontier)
+                    s.current[u] = lanes_t{};
+
+                for(std::size_t v : s.discovered)
+                {
+                    for(std::size_t w = 0; w < Lanes / bits_per_word; ++w)
+                    {
+                        s.seen[v][w] |= s.next[v][w];
+
+                        for(bit_word lanes = s.next[v][w]; lanes != 0; lanes &= lanes - 1)
+                            visit(first + w * bits_per_word + word_ctz(lanes), v, depth);
+                    }
+                }
+
+                s.current.swap(s.next);
+                s.frontier.swap(s.discovered);
+            }
+
+            // Leave the lane sets clean for the next batch of this worker
+            for(std::size_t u : s.frontier)
+                s.current[u] = lanes_t{};
+
+            std::fill(s.seen.begin(), s.seen.end(), lanes_t{});
+        }
+    });
+}
+
+// Distances from every source: result[i][v] is the depth of v in the BFS from sources[i],
+// no_node when it is not reached
+template<std::size_t Lanes = 64, typename Storage>
+std::vector<std::vector<std::size_t>> multi_source_distances(const Storage& storage, const std::vector<std::size_t>& sources,
+                                                             const multi_source_bfs_options& options = {},
+                                                             thread_pool& pool = thread_pool::default_pool())
+{
+    std::vector<std::vector<std::size_t>> result(sources.size(), std::vector<std::size_t>(storage.nodes_count(), no_node));
+
+    multi_source_bfs<Lanes>(storage, sources, [&](std::size_t source, std::size_t node, std::size_t depth)
+    {
+        result[source][node] = depth;
+    }, options, pool);
+
+    return result;
+}
+
+// Nodes reached from every source, the source included (k-hop reachability with max_depth)
+template<std::size_t Lanes = 64, typename Storage>
+std::vector<std::size_t> multi_source_reach_counts(const Storage& storage, const std::vector<std::size_t>& sources,
+                                                   const multi_source_bfs_options& options = {},
+                                                   thread_pool& pool = thread_pool::default_pool())
+{
+    std::vector<std::size_t> result(sources.size(), 0);
+
+    multi_source_bfs<Lanes>(storage, sources, [&](std::size_t source, std::size_t, std::size_t)
+    {
+        ++result[source];
+    }, options, pool);
+
+    return result;
+}
+
+template<std::size_t Lanes = 64, typename Node, typename Storage>
+std::vector<std::vector<std::size_t>> multi_source_distances(const graph<Node, Storage>& g, const std::vector<std::size_t>& sources,
+                                                             const multi_source_bfs_options& options = {},
+                                                             thread_pool& pool = thread_pool::default_pool())
+{
+    return multi_source_distances<Lanes>(g.adjacency(), sources, options, pool);
+}
+
+template<std::size_t Lanes = 64, typename Node, typename Storage>
+std::vector<std::size_t> multi_source_reach_counts(const graph<Node, Storage>& g, const std::vector<std::size_t>& sources,
+                                                   const multi_source_bfs_options& options = {},
+                                                   thread_pool& pool = thread_pool::default_pool())
+{
+    return multi_source_reach_counts<Lanes>(g.adjacency(), sources, options, pool);
+}
+
+#endif //PRACTICA2MAR_BFS_HPP
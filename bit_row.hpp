@@ -0,0 +1,284 @@
+#ifndef PRACTICA2MAR_BIT_ROW_HPP
+#define PRACTICA2MAR_BIT_ROW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <iterator>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+#define PRACTICA2MAR_AVX512_POPCOUNT
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define PRACTICA2MAR_AVX2_POPCOUNT
+#include <immintrin.h>
+#endif
+
+using bit_word = std::uint64_t;
+
+constexpr std::size_t bits_per_word = 64;
+constexpr std::size_t words_per_cache_line = 64 / sizeof(bit_word);
+
+constexpr std::size_t words_for_bits(std::size_t bits)
+{
+    return (bits + bits_per_word - 1) / bits_per_word;
+}
+
+constexpr std::size_t round_to_cache_line(std::size_t words)
+{
+    return (words + words_per_cache_line - 1) / words_per_cache_line * words_per_cache_line;
+}
+
+constexpr bit_word bit_mask(std::size_t bit)
+{
+    return bit_word{1} << (bit % bits_per_word);
+}
+
+inline std::size_t word_popcount(bit_word w)
+{
+#if defined(_MSC_VER)
+    return static_cast<std::size_t>(__popcnt64(w));
+#else
+    return static_cast<std::size_t>(__builtin_popcountll(w));
+#endif
+}
+
+inline std::size_t word_ctz(bit_word w)
+{
+    assert(w != 0);
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, w);
+    return static_cast<std::size_t>(index);
+#else
+    return static_cast<std::size_t>(__builtin_ctzll(w));
+#endif
+}
+
+// Index of the highest set bit plus one, 0 for an empty word
+inline std::size_t word_bit_width(bit_word w)
+{
+    if(w == 0)
+        return 0;
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, w);
+    return static_cast<std::size_t>(index) + 1;
+#else
+    return bits_per_word - static_cast<std::size_t>(__builtin_clzll(w));
+#endif
+}
+
+inline bit_word atomic_load_word(const bit_word* word)
+{
+#if defined(_MSC_VER)
+    return static_cast<bit_word>(_InterlockedOr64(reinterpret_cast<volatile __int64*>(const_cast<bit_word*>(word)), 0));
+#else
+    return __atomic_load_n(word, __ATOMIC_ACQUIRE);
+#endif
+}
+
+inline bit_word atomic_fetch_or_word(bit_word* word, bit_word mask)
+{
+#if defined(_MSC_VER)
+    return static_cast<bit_word>(_InterlockedOr64(reinterpret_cast<volatile __int64*>(word), static_cast<__int64>(mask)));
+#else
+    return __atomic_fetch_or(word, mask, __ATOMIC_ACQ_REL);
+#endif
+}
+
+inline bit_word atomic_fetch_and_word(bit_word* word, bit_word mask)
+{
+#if defined(_MSC_VER)
+    return static_cast<bit_word>(_InterlockedAnd64(reinterpret_cast<volatile __int64*>(word), static_cast<__int64>(mask)));
+#else
+    return __atomic_fetch_and(word, mask, __ATOMIC_ACQ_REL);
+#endif
+}
+
+struct bit_row
+{
+    const bit_word* data;
+    std::size_t words;
+
+    const bit_word* begin() const
+    {
+        return data;
+    }
+
+    const bit_word* end() const
+    {
+        return data + words;
+    }
+
+    bool test(std::size_t bit) const
+    {
+        assert(bit / bits_per_word < words);
+        return (data[bit / bits_per_word] & bit_mask(bit)) != 0;
+    }
+
+    std::size_t count() const
+    {
+        std::size_t result = 0;
+
+        for(std::size_t w = 0; w < words; ++w)
+            result += word_popcount(data[w]);
+
+        return result;
+    }
+
+    bool any() const
+    {
+        for(std::size_t w = 0; w < words; ++w)
+            if(data[w] != 0)
+                return true;
+
+        return false;
+    }
+};
+
+struct set_bit_iterator
+{
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::size_t*;
+    using reference = std::size_t;
+
+    set_bit_iterator() = default;
+
+    set_bit_iterator(bit_row row, std::size_t from = 0) :
+        _data{row.data},
+        _words{row.words},
+        _word{from / bits_per_word}
+    {
+        if(_word < _words)
+        {
+            _current = _data[_word] & ~(bit_mask(from) - 1);
+            _skip_empty();
+        }
+        else
+            _word = _words;
+    }
+
+    static set_bit_iterator end(bit_row row)
+    {
+        return {row, row.words * bits_per_word};
+    }
+
+    std::size_t operator*() const
+    {
+        return _word * bits_per_word + word_ctz(_current);
+    }
+
+    set_bit_iterator& operator++()
+    {
+        _current &= _current - 1;
+        _skip_empty();
+        return *this;
+    }
+
+    set_bit_iterator operator++(int)
+    {
+        set_bit_iterator old = *this;
+        ++(*this);
+        return old;
+    }
+
+    friend bool operator==(const set_bit_iterator& lhs, const set_bit_iterator& rhs)
+    {
+        return lhs._word == rhs._word && lhs._current == rhs._current;
+    }
+
+    friend bool operator!=(const set_bit_iterator& lhs, const set_bit_iterator& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    void _skip_empty()
+    {
+        while(_current == 0 && ++_word < _words)
+            _current = _data[_word];
+
+        if(_current == 0)
+            _word = _words;
+    }
+
+    const bit_word* _data = nullptr;
+    std::size_t _words = 0;
+    std::size_t _word = 0;
+    bit_word _current = 0;
+};
+
+// popcount(a & b) over whole rows. The vector paths are picked at compile time
+// (-mavx2, -mavx512vpopcntdq); leftover words go through the scalar loop.
+inline std::size_t count_and(bit_row a, bit_row b)
+{
+    assert(a.words == b.words);
+    std::size_t result = 0;
+    std::size_t w = 0;
+
+#if defined(PRACTICA2MAR_AVX512_POPCOUNT)
+    __m512i acc = _mm512_setzero_si512();
+
+    for(; w + 8 <= a.words; w += 8)
+    {
+        __m512i x = _mm512_and_si512(_mm512_loadu_si512(a.data + w), _mm512_loadu_si512(b.data + w));
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+    }
+
+    result += static_cast<std::size_t>(_mm512_reduce_add_epi64(acc));
+#elif defined(PRACTICA2MAR_AVX2_POPCOUNT)
+    // Nibble lookup popcount (Mula), bytes summed with vpsadbw
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+
+    for(; w + 4 <= a.words; w += 4)
+    {
+        __m256i x = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.data + w)),
+                                     _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b.data + w)));
+        __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(x, low_nibbles));
+        __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(x, 4), low_nibbles));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+    }
+
+    result += static_cast<std::size_t>(_mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+                                       _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3));
+#endif
+
+    for(; w < a.words; ++w)
+        result += word_popcount(a.data[w] & b.data[w]);
+
+    return result;
+}
+
+inline void row_and(bit_word* out, bit_row a, bit_row b)
+{
+    assert(a.words == b.words);
+
+    for(std::size_t w = 0; w < a.words; ++w)
+        out[w] = a.data[w] & b.data[w];
+}
+
+inline void row_or(bit_word* out, bit_row a, bit_row b)
+{
+    assert(a.words == b.words);
+
+    for(std::size_t w = 0; w < a.words; ++w)
+        out[w] = a.data[w] | b.data[w];
+}
+
+inline void row_or_into(bit_word* out, bit_row src)
+{
+    for(std::size_t w = 0; w < src.words; ++w)
+        out[w] |= src.data[w];
+}
+
+#endif //PRACTICA2MAR_BIT_ROW_HPP
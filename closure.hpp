@@ -0,0 +1,196 @@
+#ifndef PRACTICA2MAR_CLOSURE_HPP
+#define PRACTICA2MAR_CLOSURE_HPP
+
+#include <vector>
+#include <numeric>
+#include <stdexcept>
+
+#include "graph.hpp"
+#include "bit_row.hpp"
+#include "thread_pool.hpp"
+
+namespace closure_detail
+{
+    constexpr std::size_t table_bits = 8;
+    constexpr std::size_t table_size = std::size_t{1} << table_bits;
+    constexpr std::size_t tables_per_word = bits_per_word / table_bits;
+
+    // The words of a row that hold columns below nodes_count(). Pitches follow each
+    // matrix's capacity, so two matrices of the same size can have different ones.
+    inline bit_row live_row(const adjacency_matrix& matrix, std::size_t node)
+    {
+        return {matrix.row(node).data, words_for_bits(matrix.nodes_count())};
+    }
+
+    // Work of one column word: the rows of source it selects are ORed into the target
+    // rows, skipping target rows [skip_begin, skip_end). Dense words go through Four
+    // Russians tables (every OR of 8 consecutive source rows), so a target row costs
+    // one row OR per non-zero selector byte instead of one per set bit.
+    struct column_block
+    {
+        column_block(const adjacency_matrix& selector, const adjacency_matrix& source, adjacency_matrix& target,
+                     std::size_t word, std::size_t skip_begin, std::size_t skip_end) :
+            _selector(selector),
+            _source(source),
+            _target(target),
+            _word{word},
+            _skip_begin{skip_begin},
+            _skip_end{skip_end}
+        {}
+
+        void operator()(std::vector<bit_word>& tables, thread_pool& pool, std::size_t grain)
+        {
+            const std::size_t n = _target.nodes_count();
+            std::vector<std::size_t> set_bits(pool.size(), 0), set_bytes(pool.size(), 0);
+
+            pool.parallel_for(0, n, grain, [&](std::size_t worker, std::size_t b, std::size_t e)
+            {
+                for(std::size_t i = b; i < e; ++i)
+                {
+                    bit_word select = _select(i);
+                    set_bits[worker] += word_popcount(select);
+
+                    for(std::size_t t = 0; t < tables_per_word; ++t)
+                        set_bytes[worker] += ((select >> (t * table_bits)) & (table_size - 1)) != 0;
+                }
+            });
+
+            std::size_t direct_cost = std::accumulate(set_bits.begin(), set_bits.end(), std::size_t{0});
+            std::size_t table_cost = tables_per_word * table_size + std::accumulate(set_bytes.begin(), set_bytes.end(), std::size_t{0});
+
+            if(direct_cost == 0)
+                return;
+
+            if(table_cost < direct_cost)
+                _by_tables(tables, pool, grain);
+            else
+                _direct(pool, grain);
+        }
+
+    private:
+        bit_word _select(std::size_t i) const
+        {
+            if(i >= _skip_begin && i < _skip_end)
+                return 0;
+
+            return _selector.row(i).data[_word];
+        }
+
+        void _direct(thread_pool& pool, std::size_t grain)
+        {
+            pool.parallel_for(0, _target.nodes_count(), grain, [&](std::size_t, std::size_t b, std::size_t e)
+            {
+                for(std::size_t i = b; i < e; ++i)
+                {
+                    bit_word* target = _target.row_words(i);
+
+                    for(bit_word select = _select(i); select != 0; select &= select - 1)
+                        row_or_into(target, live_row(_source, _word * bits_per_word + word_ctz(select)));
+                }
+            });
+        }
+
+        void _by_tables(std::vector<bit_word>& tables, thread_pool& pool, std::size_t grain)
+        {
+            const std::size_t pitch = words_for_bits(_source.nodes_count());
+            tables.assign(tables_per_word * table_size * pitch, 0);
+
+            // Entry k is entry k minus its lowest bit ORed with the source row of that bit
+            pool.parallel_for(0, tables_per_word, 1, [&](std::size_t, std::size_t b, std::size_t e)
+            {
+                for(std::size_t t = b; t < e; ++t)
+                {
+                    bit_word* table = tables.data() + t * table_size * pitch;
+
+                    for(std::size_t k = 1; k < table_size; ++k)
+                    {
+                        std::size_t row = _word * bits_per_word + t * table_bits + word_ctz(k);
+                        bit_word* entry = table + k * pitch;
+
+                        std::copy(table + (k & (k - 1)) * pitch, table + (k & (k - 1)) * pitch + pitch, entry);
+
+                        if(row < _source.nodes_count())
+                            row_or_into(entry, live_row(_source, row));
+                    }
+                }
+            });
+
+            pool.parallel_for(0, _target.nodes_count(), grain, [&](std::size_t, std::size_t b, std::size_t e)
+            {
+                for(std::size_t i = b; i < e; ++i)
+                {
+                    bit_word select = _select(i);
+                    bit_word* target = _target.row_words(i);
+
+                    for(std::size_t t = 0; t < tables_per_word; ++t)
+                    {
+                        std::size_t k = (select >> (t * table_bits)) & (table_size - 1);
+
+                        if(k != 0)
+                            row_or_into(target, {tables.data() + (t * table_size + k) * pitch, pitch});
+                    }
+                }
+            });
+        }
+
+        const adjacency_matrix& _selector;
+        const adjacency_matrix& _source;
+        adjacency_matrix& _target;
+        std::size_t _word, _skip_begin, _skip_end;
+    };
+}
+
+// Boolean product: (i, j) is set when some k has (i, k) in a and (k, j) in b. Column
+// words of a are processed one at a time so the 64 rows of b they select stay in cache.
+inline adjacency_matrix multiply(const adjacency_matrix& a, const adjacency_matrix& b,
+                                 thread_pool& pool = thread_pool::default_pool(), std::size_t grain = 64)
+{
+    if(a.nodes_count() != b.nodes_count())
+        throw std::logic_error{"multiply(a,b): Matrices of different sizes"};
+
+    const std::size_t n = a.nodes_count();
+    adjacency_matrix result{n, &a != &b || a.directed() || b.directed()};
+    std::vector<bit_word> tables;
+
+    for(std::size_t w = 0; w < words_for_bits(n); ++w)
+        closure_detail::column_block{a, b, result, w, 0, 0}(tables, pool, grain);
+
+    return result;
+}
+
+// Reachability through paths of one or more edges. Blocked Warshall: the 64 pivot rows of
+// a block are closed among themselves first, then every other row ORs in the pivot rows
+// its block word selects, which are already final for that block.
+inline adjacency_matrix transitive_closure(const adjacency_matrix& matrix,
+                                           thread_pool& pool = thread_pool::default_pool(), std::size_t grain = 64)
+{
+    const std::size_t n = matrix.nodes_count();
+    adjacency_matrix result{n, matrix.directed()};
+    std::vector<bit_word> tables;
+
+    for(std::size_t i = 0; i < n; ++i)
+        std::copy(closure_detail::live_row(matrix, i).begin(), closure_detail::live_row(matrix, i).end(), result.row_words(i));
+
+    for(std::size_t w = 0; w < words_for_bits(n); ++w)
+    {
+        std::size_t pivots_begin = w * bits_per_word, pivots_end = std::min(n, pivots_begin + bits_per_word);
+
+        for(std::size_t k = pivots_begin; k < pivots_end; ++k)
+            for(std::size_t i = pivots_begin; i < pivots_end; ++i)
+                if(i != k && result(i, k))
+                    row_or_into(result.row_words(i), closure_detail::live_row(result, k));
+
+        closure_detail::column_block{result, result, result, w, pivots_begin, pivots_end}(tables, pool, grain);
+    }
+
+    return result;
+}
+
+template<typename Node>
+adjacency_matrix transitive_closure(const graph<Node, adjacency_matrix>& g,
+                                    thread_pool& pool = thread_pool::default_pool(), std::size_t grain = 64)
+{
+    return transitive_closure(g.adjacency(), pool, grain);
+}
+
+#endif //PRACTICA2MAR_CLOSURE_HPP
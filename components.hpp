@@ -0,0 +1,416 @@
+#ifndef PRACTICA2MAR_COMPONENTS_HPP
+#define PRACTICA2MAR_COMPONENTS_HPP
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <stdexcept>
+#include <cassert>
+
+#include "graph.hpp"
+#include "thread_pool.hpp"
+
+// Lock-free disjoint sets. Roots are only ever linked under a smaller root, so the
+// representative of a set is always its smallest element.
+struct concurrent_union_find
+{
+    explicit concurrent_union_find(std::size_t count = 0)
+    {
+        grow(count);
+    }
+
+    std::size_t size() const noexcept
+    {
+        return _size;
+    }
+
+    // Not thread safe, must not run concurrently with find() or unite()
+    void grow(std::size_t count)
+    {
+        if(count <= _capacity)
+        {
+            for(; _size < count; ++_size)
+                _parent[_size].store(_size, std::memory_order_relaxed);
+
+            return;
+        }
+
+        std::size_t capacity = std::max(count, 2 * _capacity);
+        std::unique_ptr<std::atomic<std::size_t>[]> parent{new std::atomic<std::size_t>[capacity]};
+
+        for(std::size_t i = 0; i < capacity; ++i)
+            parent[i].store(i < _size ? _parent[i].load(std::memory_order_relaxed) : i, std::memory_order_relaxed);
+
+        _parent = std::move(parent);
+        _capacity = capacity;
+        _size = count;
+    }
+
+    std::size_t find(std::size_t x)
+    {
+        assert(x < size());
+
+        for(;;)
+        {
+            std::size_t parent = _parent[x].load(std::memory_order_acquire);
+
+            if(parent == x)
+                return x;
+
+            std::size_t grandparent = _parent[parent].load(std::memory_order_acquire);
+
+            if(parent != grandparent)
+                _parent[x].compare_exchange_weak(parent, grandparent, std::memory_order_acq_rel);
+
+            x = grandparent;
+        }
+    }
+
+    bool unite(std::size_t a, std::size_t b)
+    {
+        for(;;)
+        {
+            a = find(a);
+            b = find(b);
+
+            if(a == b)
+                return false;
+            if(a < b)
+                std::swap(a, b);
+
+            std::size_t expected = a;
+
+            if(_parent[a].compare_exchange_strong(expected, b, std::memory_order_acq_rel))
+                return true;
+        }
+    }
+
+    bool same(std::size_t a, std::size_t b)
+    {
+        for(;;)
+        {
+            a = find(a);
+            b = find(b);
+
+            if(a == b)
+                return true;
+            if(_parent[a].load(std::memory_order_acquire) == a)
+                return false;
+        }
+    }
+
+private:
+    std::unique_ptr<std::atomic<std::size_t>[]> _parent;
+    std::size_t _size = 0;
+    std::size_t _capacity = 0;
+};
+
+struct components_result
+{
+    std::vector<std::size_t> label;
+    std::vector<std::size_t> sizes;
+
+    std::size_t count() const
+    {
+        return sizes.size();
+    }
+};
+
+namespace components_detail
+{
+    // Labels are numbered by the smallest node of each component
+    inline components_result compact(concurrent_union_find& sets, thread_pool& pool, std::size_t grain)
+    {
+        std::size_t n = sets.size();
+        components_result result;
+        result.label.resize(n);
+
+        pool.parallel_for(0, n, grain, [&](std::size_t, std::size_t b, std::size_t e)
+        {
+            for(std::size_t v = b; v < e; ++v)
+                result.label[v] = sets.find(v);
+        });
+
+        for(std::size_t v = 0; v < n; ++v)
+        {
+            if(result.label[v] == v)
+            {
+                result.label[v] = result.sizes.size();
+                result.sizes.push_back(0);
+            }
+            else
+                result.label[v] = result.label[result.label[v]];
+
+            ++result.sizes[result.label[v]];
+        }
+
+        return result;
+    }
+
+    template<typename Storage>
+    void unite_edges(concurrent_union_find& sets, const Storage& storage, thread_pool& pool, std::size_t grain)
+    {
+        pool.parallel_for(0, storage.nodes_count(), grain, [&](std::size_t, std::size_t b, std::size_t e)
+        {
+            for(std::size_t u = b; u < e; ++u)
+                for(std::size_t v : storage.neighbors(u))
+                    if(storage.directed() || v > u)
+                        sets.unite(u, v);
+        });
+    }
+}
+
+// Weakly connected components for directed storages. Removed ids of a matrix that has
+// not been compacted come out as singleton components.
+template<typename Storage>
+components_result connected_components(const Storage& storage, thread_pool& pool = thread_pool::default_pool(),
+                                       std::size_t grain = 256)
+{
+    concurrent_union_find sets{storage.nodes_count()};
+    components_detail::unite_edges(sets, storage, pool, grain);
+    return components_detail::compact(sets, pool, grain);
+}
+
+template<typename Node, typename Storage>
+components_result connected_components(const graph<Node, Storage>& g, thread_pool& pool = thread_pool::default_pool(),
+                                       std::size_t grain = 256)
+{
+    return connected_components(g.adjacency(), pool, grain);
+}
+
+// Keeps components up to date while nodes and edges are added. Edge removals
+// cannot be undone on disjoint sets and need a new tracker built from the graph.
+// Writes done straight on the storage are not seen; go through track_components() to
+// have them applied to both.
+struct incremental_components
+{
+    using edge_t = std::pair<std::size_t, std::size_t>;
+
+    incremental_components() = default;
+
+    template<typename Storage>
+    explicit incremental_components(const Storage& storage, thread_pool& pool = thread_pool::default_pool()) :
+        _sets{storage.nodes_count()},
+        _count{storage.nodes_count()}
+    {
+        components_detail::unite_edges(_sets, storage, pool, 256);
+        _count = 0;
+
+        for(std::size_t v = 0; v < _sets.size(); ++v)
+            if(_sets.find(v) == v)
+                ++_count;
+    }
+
+    template<typename Node, typename Storage>
+    explicit incremental_components(const graph<Node, Storage>& g, thread_pool& pool = thread_pool::default_pool()) :
+        incremental_components{g.adjacency(), pool}
+    {}
+
+    std::size_t nodes_count() const
+    {
+        return _sets.size();
+    }
+
+    std::size_t count() const
+    {
+        return _count;
+    }
+
+    void add_node()
+    {
+        add_nodes(1);
+    }
+
+    void add_nodes(std::size_t count)
+    {
+        _sets.grow(_sets.size() + count);
+        _count += count;
+    }
+
+    void add_edge(std::size_t i, std::size_t j)
+    {
+        if(_sets.unite(i, j))
+            --_count;
+    }
+
+    void add_edges(std::initializer_list<std::initializer_list<int>> pairs)
+    {
+        for(auto pair : pairs)
+        {
+            assert(std::end(pair) - std::begin(pair) == 2);
+            add_edge(*(std::begin(pair)), *(std::begin(pair) + 1));
+        }
+    }
+
+    void add_edges(const std::vector<edge_t>& edges)
+    {
+        add_edges(edges.begin(), edges.end());
+    }
+
+    // Any range or iterator pair of edges, anything with first and second members
+    template<typename Iterator>
+    void add_edges(Iterator first, Iterator last)
+    {
+        for(; first != last; ++first)
+        {
+            auto edge = *first;
+            add_edge(edge.first, edge.second);
+        }
+    }
+
+    template<typename Range, typename = decltype(std::begin(std::declval<const Range&>()))>
+    void add_edges(const Range& edges)
+    {
+        add_edges(std::begin(edges), std::end(edges));
+    }
+
+    std::size_t component(std::size_t node)
+    {
+        return _sets.find(node);
+    }
+
+    bool connected(std::size_t i, std::size_t j)
+    {
+        return _sets.same(i, j);
+    }
+
+    components_result result(thread_pool& pool = thread_pool::default_pool())
+    {
+        return components_detail::compact(_sets, pool, 256);
+    }
+
+private:
+    concurrent_union_find _sets;
+    std::size_t _count = 0;
+};
+
+// Write view over a storage or graph that applies every node and edge addition to it and
+// to a tracker, so the components stay current without being recomputed. New nodes reach
+// the tracker on the next write or components() call, and must be appended: ids shifted
+// by add_node(position) or reused after remove_node() are not followed. Removing an edge
+// through the view throws, since the tracker cannot split a component.
+template<typename Target>
+struct tracked_components
+{
+private:
+    struct node_proxy;
+
+public:
+    using edge_t = incremental_components::edge_t;
+
+    tracked_components(Target& target, incremental_components& components) :
+        _target{&target},
+        _components{&components}
+    {
+        assert(components.nodes_count() <= target.nodes_count());
+    }
+
+    std::size_t nodes_count() const
+    {
+        return _target->nodes_count();
+    }
+
+    incremental_components& components()
+    {
+        _sync();
+        return *_components;
+    }
+
+    template<typename... Args>
+    decltype(auto) add_node(Args&&... args)
+    {
+        return _target->add_node(std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    void add_nodes(std::size_t count, const Args&... args)
+    {
+        _target->add_nodes(count, args...);
+    }
+
+    void add_edges(std::initializer_list<std::initializer_list<int>> pairs)
+    {
+        _sync();
+        _target->add_edges(pairs);
+        _components->add_edges(pairs);
+    }
+
+    void add_edges(const std::vector<edge_t>& edges)
+    {
+        _sync();
+        _target->add_edges(edges);
+        _components->add_edges(edges);
+    }
+
+    template<typename Iterator>
+    void add_edges(Iterator first, Iterator last)
+    {
+        _sync();
+        _target->add_edges(first, last);
+        _components->add_edges(first, last);
+    }
+
+    template<typename Range, typename = decltype(std::begin(std::declval<const Range&>()))>
+    void add_edges(const Range& edges)
+    {
+        add_edges(std::begin(edges), std::end(edges));
+    }
+
+    bool operator()(std::size_t i, std::size_t j) const
+    {
+        return static_cast<const Target&>(*_target)(i, j);
+    }
+
+    node_proxy operator()(std::size_t i, std::size_t j)
+    {
+        return {this, i, j};
+    }
+
+private:
+    void _sync()
+    {
+        if(_target->nodes_count() > _components->nodes_count())
+            _components->add_nodes(_target->nodes_count() - _components->nodes_count());
+    }
+
+    struct node_proxy
+    {
+        node_proxy(tracked_components* view, std::size_t _i, std::size_t _j) :
+            _ref{view},
+            i{_i},
+            j{_j}
+        {}
+
+        bool operator=(bool b)
+        {
+            if(!b)
+                throw std::logic_error{"tracked_components: Edge removals cannot be tracked, build a new incremental_components"};
+
+            _ref->_sync();
+            (*_ref->_target)(i, j) = true;
+            _ref->_components->add_edge(i, j);
+            return b;
+        }
+
+        operator bool() const
+        {
+            return static_cast<const tracked_components&>(*_ref)(i, j);
+        }
+
+        tracked_components* _ref;
+        std::size_t i, j;
+    };
+
+    Target* _target;
+    incremental_components* _components;
+};
+
+template<typename Target>
+tracked_components<Target> track_components(Target& target, incremental_components& components)
+{
+    return {target, components};
+}
+
+#endif //PRACTICA2MAR_COMPONENTS_HPP
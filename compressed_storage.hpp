@@ -0,0 +1,372 @@
+#ifndef PRACTICA2MAR_COMPRESSED_STORAGE_HPP
+#define PRACTICA2MAR_COMPRESSED_STORAGE_HPP
+
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+#include <iostream>
+#include <algorithm>
+#include <utility>
+
+#include <manu343726/range/v3/all.hpp>
+#include "graph.hpp"
+
+// Read-only adjacency in the WebGraph style, for graphs whose CSR does not fit in memory.
+// Every row is its degree followed by its sorted neighbors as gaps: the first one relative
+// to the row (zigzag encoded, since it can be below it) and the rest minus one, as they
+// strictly increase. All of them are LEB128 varints, so sparse graphs with some locality
+// take one or two bytes per arc instead of eight. Only the byte offset of one row out of
+// every sample_rate is kept; reaching any other row skips at most sample_rate - 1 rows.
+struct compressed_storage
+{
+    using edge_t = std::pair<std::size_t, std::size_t>;
+
+    // Decodes one row on the fly
+    struct neighbor_iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::size_t*;
+        using reference = std::size_t;
+
+        neighbor_iterator() = default;
+
+        neighbor_iterator(const std::uint8_t* data, std::size_t row, std::size_t remaining) :
+            _data{data},
+            _remaining{remaining}
+        {
+            if(_remaining > 0)
+                _current = row + unzigzag(read_varint(_data));
+        }
+
+        std::size_t operator*() const
+        {
+            return _current;
+        }
+
+        neighbor_iterator& operator++()
+        {
+            if(--_remaining > 0)
+                _current += read_varint(_data) + 1;
+
+            return *this;
+        }
+
+        neighbor_iterator operator++(int)
+        {
+            neighbor_iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        friend bool operator==(const neighbor_iterator& lhs, const neighbor_iterator& rhs)
+        {
+            return lhs._remaining == rhs._remaining;
+        }
+
+        friend bool operator!=(const neighbor_iterator& lhs, const neighbor_iterator& rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        const std::uint8_t* _data = nullptr;
+        std::size_t _remaining = 0;
+        std::size_t _current = 0;
+    };
+
+    struct edge_iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = edge_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const edge_t*;
+        using reference = edge_t;
+
+        edge_iterator() = default;
+
+        edge_iterator(const compressed_storage* storage, std::size_t row) :
+            _storage{storage},
+            _row{row}
+        {
+            if(_row < _storage->nodes_count())
+            {
+                _data = _storage->_row_data(_row);
+                _begin_row();
+                _settle();
+            }
+        }
+
+        edge_t operator*() const
+        {
+            return std::make_pair(_row, *_neighbor);
+        }
+
+        edge_iterator& operator++()
+        {
+            ++_neighbor;
+            _settle();
+            return *this;
+        }
+
+        edge_iterator operator++(int)
+        {
+            edge_iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        friend bool operator==(const edge_iterator& lhs, const edge_iterator& rhs)
+        {
+            return lhs._row == rhs._row && lhs._neighbor == rhs._neighbor;
+        }
+
+        friend bool operator!=(const edge_iterator& lhs, const edge_iterator& rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        // Rows are stored back to back, so the next one starts where the previous ended
+        void _begin_row()
+        {
+            std::size_t degree = read_varint(_data);
+            const std::uint8_t* row = _data;
+
+            _data = skip_varints(_data, degree);
+            _neighbor = {row, _row, degree};
+        }
+
+        // Undirected edges are only reported from their lower endpoint
+        void _settle()
+        {
+            while(true)
+            {
+                if(_neighbor == neighbor_iterator{})
+                {
+                    if(++_row == _storage->nodes_count())
+                        return;
+
+                    _begin_row();
+                    continue;
+                }
+
+                if(_storage->directed() || *_neighbor >= _row)
+                    return;
+
+                ++_neighbor;
+            }
+        }
+
+        const compressed_storage* _storage = nullptr;
+        const std::uint8_t* _data = nullptr;
+        std::size_t _row = 0;
+        neighbor_iterator _neighbor;
+    };
+
+    compressed_storage(bool directed = false, std::size_t sample_rate = 16) :
+        _index{0},
+        _sample_rate{sample_rate},
+        _directed{directed}
+    {
+        if(sample_rate == 0)
+            throw std::logic_error{"compressed_storage(): Sample rate must be positive"};
+    }
+
+    // Any storage with neighbors(); rows are sorted and deduplicated while encoding
+    template<typename Storage, typename = decltype(std::declval<const Storage&>().neighbors(0))>
+    explicit compressed_storage(const Storage& storage, std::size_t sample_rate = 16) :
+        compressed_storage{storage.directed(), sample_rate}
+    {
+        std::vector<std::size_t> row;
+        _index.clear();
+        _index.reserve(storage.nodes_count() / _sample_rate + 1);
+
+        for(std::size_t i = 0; i < storage.nodes_count(); ++i)
+        {
+            row.clear();
+
+            for(std::size_t j : storage.neighbors(i))
+                row.push_back(j);
+
+            if(!std::is_sorted(row.begin(), row.end()))
+                std::sort(row.begin(), row.end());
+
+            row.erase(std::unique(row.begin(), row.end()), row.end());
+            _push_row(i, row);
+        }
+
+        _index.push_back(_bytes.size());
+        _bytes.shrink_to_fit();
+        _index.shrink_to_fit();
+    }
+
+    template<typename Node, typename Storage>
+    explicit compressed_storage(const graph<Node, Storage>& g, std::size_t sample_rate = 16) :
+        compressed_storage{g.adjacency(), sample_rate}
+    {}
+
+    bool directed() const noexcept
+    {
+        return _directed;
+    }
+
+    std::size_t nodes_count() const noexcept
+    {
+        return _nodes_count;
+    }
+
+    std::size_t arcs_count() const noexcept
+    {
+        return _arcs_count;
+    }
+
+    std::size_t sample_rate() const noexcept
+    {
+        return _sample_rate;
+    }
+
+    // Bytes of the encoded rows plus the sampled index
+    std::size_t bytes() const noexcept
+    {
+        return _bytes.size() + _index.size() * sizeof(std::uint64_t);
+    }
+
+    std::size_t degree(std::size_t node) const
+    {
+        assert(node < nodes_count());
+        const std::uint8_t* data = _row_data(node);
+        return read_varint(data);
+    }
+
+    auto neighbors(std::size_t node) const
+    {
+        assert(node < nodes_count());
+        const std::uint8_t* data = _row_data(node);
+        std::size_t degree = read_varint(data);
+
+        return ranges::make_iterator_range(neighbor_iterator{data, node, degree}, neighbor_iterator{});
+    }
+
+    auto edges() const
+    {
+        return ranges::make_iterator_range(edge_iterator{this, 0}, edge_iterator{this, nodes_count()});
+    }
+
+    // Decodes row i up to the first neighbor not below j
+    bool operator()(std::size_t i, std::size_t j) const
+    {
+        assert(i < nodes_count() && j < nodes_count());
+
+        for(std::size_t k : neighbors(i))
+        {
+            if(k >= j)
+                return k == j;
+        }
+
+        return false;
+    }
+
+    bool at(std::size_t i, std::size_t j) const
+    {
+        if (i < nodes_count() && j < nodes_count())
+            return (*this)(i, j);
+        else
+            throw std::out_of_range{"compressed_storage::at(i,j): Index out of range"};
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const compressed_storage& m)
+    {
+        for(std::size_t i = 0; i < m.nodes_count(); ++i)
+        {
+            os << "node " << i << ": ";
+
+            for(auto j : m.neighbors(i))
+                os << j << " ";
+
+            os << "\n";
+        }
+
+        return os;
+    }
+
+    static std::size_t read_varint(const std::uint8_t*& data)
+    {
+        std::size_t value = 0;
+
+        for(unsigned shift = 0; ; shift += 7)
+        {
+            std::uint8_t byte = *data++;
+            value |= static_cast<std::size_t>(byte & 0x7f) << shift;
+
+            if(!(byte & 0x80))
+                return value;
+        }
+    }
+
+    static const std::uint8_t* skip_varints(const std::uint8_t* data, std::size_t count)
+    {
+        while(count > 0)
+            count -= !(*data++ & 0x80);
+
+        return data;
+    }
+
+    static std::size_t unzigzag(std::size_t value)
+    {
+        return (value >> 1) ^ (std::size_t{0} - (value & 1));
+    }
+
+private:
+    void _write_varint(std::size_t value)
+    {
+        while(value >= 0x80)
+        {
+            _bytes.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+
+        _bytes.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    void _push_row(std::size_t node, const std::vector<std::size_t>& row)
+    {
+        if(node % _sample_rate == 0)
+            _index.push_back(_bytes.size());
+
+        _write_varint(row.size());
+
+        if(!row.empty())
+        {
+            // Zigzag of row.front() - node, computed without leaving size_t
+            _write_varint(row.front() >= node ? (row.front() - node) << 1 : ((node - row.front()) << 1) - 1);
+
+            for(std::size_t k = 1; k < row.size(); ++k)
+                _write_varint(row[k] - row[k - 1] - 1);
+        }
+
+        _arcs_count += row.size();
+        ++_nodes_count;
+    }
+
+    const std::uint8_t* _row_data(std::size_t node) const
+    {
+        const std::uint8_t* data = _bytes.data() + _index[node / _sample_rate];
+
+        for(std::size_t skipped = node % _sample_rate; skipped > 0; --skipped)
+            data = skip_varints(data, read_varint(data));
+
+        return data;
+    }
+
+    std::vector<std::uint8_t> _bytes;
+    // Byte offset of every sample_rate-th row, plus the end of the stream
+    std::vector<std::uint64_t> _index;
+    std::size_t _nodes_count = 0, _arcs_count = 0, _sample_rate;
+    bool _directed;
+};
+
+#endif //PRACTICA2MAR_COMPRESSED_STORAGE_HPP
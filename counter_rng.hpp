@@ -0,0 +1,58 @@
+#ifndef PRACTICA2MAR_COUNTER_RNG_HPP
+#define PRACTICA2MAR_COUNTER_RNG_HPP
+
+#include <cstdint>
+#include <limits>
+
+// Counter-based generator: the n-th output of a (seed, stream) pair is a pure function of
+// the three, so work split in fixed streams reproduces exactly on any number of threads.
+struct counter_rng
+{
+    using result_type = std::uint64_t;
+
+    counter_rng(std::uint64_t seed, std::uint64_t stream = 0) :
+        _key{mix(seed ^ mix(stream + golden))}
+    {}
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        return mix(_key + (++_counter) * golden);
+    }
+
+    // Uniform in (0, 1]
+    double uniform()
+    {
+        return static_cast<double>(((*this)() >> 11) + 1) * (1.0 / 9007199254740992.0);
+    }
+
+    // Uniform in [0, bound)
+    std::uint64_t below(std::uint64_t bound)
+    {
+        return (*this)() % bound;
+    }
+
+    static std::uint64_t mix(std::uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+private:
+    static constexpr std::uint64_t golden = 0x9e3779b97f4a7c15ull;
+
+    std::uint64_t _key;
+    std::uint64_t _counter = 0;
+};
+
+#endif //PRACTICA2MAR_COUNTER_RNG_HPP
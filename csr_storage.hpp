@@ -0,0 +1,477 @@
+#ifndef PRACTICA2MAR_CSR_STORAGE_HPP
+#define PRACTICA2MAR_CSR_STORAGE_HPP
+
+#include <utility>
+#include <iterator>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+#include <manu343726/range/v3/all.hpp>
+
+namespace csr_detail
+{
+    // Iterates the arcs of any CSR-layout storage (offsets(), targets(), directed());
+    // undirected edges are only reported from their lower endpoint. weight() is there
+    // for storages carrying one per arc.
+    template<typename Storage>
+    struct edge_iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<std::size_t, std::size_t>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = value_type;
+
+        edge_iterator() = default;
+
+        edge_iterator(const Storage* storage, std::size_t row, std::size_t pos) :
+            _storage{storage},
+            _row{row},
+            _pos{pos}
+        {
+            _settle();
+        }
+
+        value_type operator*() const
+        {
+            return std::make_pair(_row, _storage->targets()[_pos]);
+        }
+
+        template<typename S = Storage>
+        auto weight() const -> decltype(std::declval<const S&>().arc_weight(std::size_t{}))
+        {
+            return _storage->arc_weight(_pos);
+        }
+
+        edge_iterator& operator++()
+        {
+            ++_pos;
+            _settle();
+            return *this;
+        }
+
+        edge_iterator operator++(int)
+        {
+            edge_iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        friend bool operator==(const edge_iterator& lhs, const edge_iterator& rhs)
+        {
+            return lhs._pos == rhs._pos;
+        }
+
+        friend bool operator!=(const edge_iterator& lhs, const edge_iterator& rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        void _settle()
+        {
+            const auto& offsets = _storage->offsets();
+            const auto& targets = _storage->targets();
+
+            while(_pos < targets.size())
+            {
+                while(_pos == offsets[_row + 1])
+                    ++_row;
+
+                if(_storage->directed() || targets[_pos] >= _row)
+                    return;
+
+                ++_pos;
+            }
+        }
+
+        const Storage* _storage = nullptr;
+        std::size_t _row = 0, _pos = 0;
+    };
+
+    // What an arc carries besides its target, and the array that holds it next to the
+    // targets. Plain adjacency carries nothing and keeps no array.
+    struct no_payload
+    {};
+
+    struct no_payload_array
+    {
+        no_payload operator[](std::size_t) const
+        {
+            return {};
+        }
+
+        void push_back(no_payload)
+        {}
+
+        void clear()
+        {}
+    };
+
+    template<typename Payload>
+    struct pending_arc
+    {
+        std::size_t from, to;
+        Payload payload;
+        bool value;
+    };
+
+    // Merges the buffered writes into sorted, deduplicated rows, the last write of an arc
+    // winning. payloads is kept parallel to targets.
+    template<typename Payload, typename PayloadArray>
+    void merge_pending(std::vector<std::size_t>& offsets, std::vector<std::size_t>& targets, PayloadArray& payloads,
+                       std::vector<pending_arc<Payload>>& pending, bool directed)
+    {
+        struct entry
+        {
+            std::size_t from, to, seq;
+            Payload payload;
+            bool value;
+        };
+
+        const std::size_t nodes_count = offsets.size() - 1;
+        std::vector<entry> entries;
+        entries.reserve(targets.size() + 2 * pending.size());
+
+        for(std::size_t i = 0; i < nodes_count; ++i)
+            for(std::size_t k = offsets[i]; k < offsets[i + 1]; ++k)
+                entries.push_back({i, targets[k], 0, payloads[k], true});
+
+        std::size_t seq = 1;
+
+        for(const auto& arc : pending)
+        {
+            entries.push_back({arc.from, arc.to, seq, arc.payload, arc.value});
+
+            if(!directed && arc.from != arc.to)
+                entries.push_back({arc.to, arc.from, seq, arc.payload, arc.value});
+
+            ++seq;
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const entry& lhs, const entry& rhs)
+        {
+            return std::tie(lhs.from, lhs.to, lhs.seq) < std::tie(rhs.from, rhs.to, rhs.seq);
+        });
+
+        std::fill(offsets.begin(), offsets.end(), std::size_t{0});
+        targets.clear();
+        payloads.clear();
+
+        for(std::size_t k = 0; k < entries.size(); ++k)
+        {
+            bool last = k + 1 == entries.size() ||
+                        entries[k + 1].from != entries[k].from ||
+                        entries[k + 1].to != entries[k].to;
+
+            if(last && entries[k].value)
+            {
+                targets.push_back(entries[k].to);
+                payloads.push_back(entries[k].payload);
+                ++offsets[entries[k].from + 1];
+            }
+        }
+
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        pending.clear();
+        pending.shrink_to_fit();
+    }
+}
+
+// Compressed sparse row adjacency. Edge writes are buffered and only become
+// visible to queries after freeze(), which merges them into sorted, deduplicated rows.
+struct csr_storage {
+private:
+    struct node_proxy;
+
+public:
+    using edge_t = std::pair<std::size_t, std::size_t>;
+
+    using edge_iterator = csr_detail::edge_iterator<csr_storage>;
+
+    csr_storage(bool directed = false) : _directed{ directed }
+    {}
+
+    csr_storage(std::size_t nodes_count, bool directed = false) :
+        _offsets(nodes_count + 1, 0),
+        _directed{directed}
+    {}
+
+    csr_storage(std::initializer_list<std::initializer_list<int>> pairs, std::size_t nodes_count, bool directed = false) :
+        csr_storage{nodes_count, directed}
+    {
+        add_edges(pairs);
+        freeze();
+    }
+
+    bool directed() const noexcept
+    {
+        return _directed;
+    }
+
+    std::size_t nodes_count() const
+    {
+        return _offsets.size() - 1;
+    }
+
+    std::size_t arcs_count() const
+    {
+        return _targets.size();
+    }
+
+    const std::vector<std::size_t>& offsets() const noexcept
+    {
+        return _offsets;
+    }
+
+    const std::vector<std::size_t>& targets() const noexcept
+    {
+        return _targets;
+    }
+
+    bool frozen() const noexcept
+    {
+        return _pending.empty();
+    }
+
+    void clear()
+    {
+        std::fill(_offsets.begin(), _offsets.end(), std::size_t{0});
+        _targets.clear();
+        _pending.clear();
+    }
+
+    std::size_t degree(std::size_t node) const
+    {
+        assert(node < nodes_count());
+        return _offsets[node + 1] - _offsets[node];
+    }
+
+    std::size_t count_common_neighbors(std::size_t i, std::size_t j) const
+    {
+        std::size_t result = 0;
+        const std::size_t *a = _row_begin(i), *b = _row_begin(j);
+
+        while(a != _row_end(i) && b != _row_end(j))
+        {
+            if(*a < *b)
+                ++a;
+            else if(*b < *a)
+                ++b;
+            else
+            {
+                ++result;
+                ++a;
+                ++b;
+            }
+        }
+
+        return result;
+    }
+
+    std::vector<std::size_t> common_neighbors(std::size_t i, std::size_t j) const
+    {
+        std::vector<std::size_t> result;
+        std::set_intersection(_row_begin(i), _row_end(i), _row_begin(j), _row_end(j), std::back_inserter(result));
+        return result;
+    }
+
+    auto neighbors(std::size_t node) const
+    {
+        assert(node < nodes_count());
+        return ranges::make_iterator_range(_row_begin(node), _row_end(node));
+    }
+
+    auto edges() const
+    {
+        return ranges::make_iterator_range(edge_iterator{this, 0, 0},
+                                           edge_iterator{this, nodes_count(), _targets.size()});
+    }
+
+    void add_edges(std::initializer_list<std::initializer_list<int>> pairs) {
+        _apply_edges(pairs, true);
+    }
+
+    void add_edges(const std::vector<edge_t>& edges) {
+        _pending.reserve(_pending.size() + edges.size());
+
+        for(const auto& edge : edges)
+        {
+            assert(edge.first < nodes_count() && edge.second < nodes_count());
+            _pending.push_back({edge.first, edge.second, {}, true});
+        }
+    }
+
+    void remove_edges(std::initializer_list<std::initializer_list<int>> pairs) {
+        _apply_edges(pairs, false);
+    }
+
+    // Any range or iterator pair of edges, buffered like the other writes
+    template<typename Iterator>
+    void add_edges(Iterator first, Iterator last) {
+        _buffer_edges(first, last, true);
+    }
+
+    template<typename Iterator>
+    void remove_edges(Iterator first, Iterator last) {
+        _buffer_edges(first, last, false);
+    }
+
+    void edges(std::initializer_list<std::initializer_list<int>> pairs) {
+        clear();
+        add_edges(pairs);
+        freeze();
+    }
+
+    bool operator()(std::size_t i, std::size_t j) const noexcept {
+        assert(i < nodes_count() && j < nodes_count());
+        return _at(i,j);
+    }
+
+    node_proxy operator()(std::size_t i, std::size_t j) noexcept {
+        assert(i < nodes_count() && j < nodes_count());
+        return {this, i, j};
+    }
+
+    bool at(std::size_t i, std::size_t j) const {
+        if (i < nodes_count() && j < nodes_count())
+            return (*this)(i, j);
+        else
+            throw std::out_of_range{"csr_storage::at(i,j): Index out of range"};
+    }
+
+    node_proxy at(std::size_t i, std::size_t j) {
+        if (i < nodes_count() && j < nodes_count())
+            return (*this)(i, j);
+        else
+            throw std::out_of_range{"csr_storage::at(i,j): Index out of range"};
+    }
+
+    void reserve(std::size_t nodes_count)
+    {
+        _offsets.reserve(nodes_count + 1);
+    }
+
+    void add_node()
+    {
+        _offsets.push_back(_offsets.back());
+    }
+
+    void add_nodes(std::size_t count)
+    {
+        _offsets.resize(_offsets.size() + count, _offsets.back());
+    }
+
+    void add_node(std::size_t node)
+    {
+        if(node >= nodes_count())
+            return add_node();
+
+        freeze();
+
+        for(auto& target : _targets)
+            if(target >= node)
+                ++target;
+
+        _offsets.insert(_offsets.begin() + node + 1, _offsets[node]);
+    }
+
+    void freeze()
+    {
+        if(frozen())
+            return;
+
+        csr_detail::no_payload_array payloads;
+        csr_detail::merge_pending(_offsets, _targets, payloads, _pending, directed());
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const csr_storage& m)
+    {
+        for(std::size_t i = 0; i < m.nodes_count(); ++i)
+        {
+            os << "node " << i << ": ";
+
+            for(auto j : m.neighbors(i))
+                os << j << " ";
+
+            os << "\n";
+        }
+
+        return os;
+    }
+
+private:
+    void _apply_edges(std::initializer_list<std::initializer_list<int>> pairs, bool value)
+    {
+        for(auto pair : pairs)
+        {
+            assert(std::end(pair) - std::begin(pair) == 2);
+
+            int a = *(std::begin(pair));
+            int b = *(std::begin(pair) + 1);
+
+            (*this)(a,b) = value;
+        }
+    }
+
+    template<typename Iterator>
+    void _buffer_edges(Iterator first, Iterator last, bool value)
+    {
+        for(; first != last; ++first)
+        {
+            auto edge = *first;
+            assert(edge.first < nodes_count() && edge.second < nodes_count());
+            _pending.push_back({edge.first, edge.second, {}, value});
+        }
+    }
+
+    const std::size_t* _row_begin(std::size_t row) const
+    {
+        return _targets.data() + _offsets[row];
+    }
+
+    const std::size_t* _row_end(std::size_t row) const
+    {
+        return _targets.data() + _offsets[row + 1];
+    }
+
+    bool _at(std::size_t i, std::size_t j) const
+    {
+        return std::binary_search(_row_begin(i), _row_end(i), j);
+    }
+
+    struct node_proxy
+    {
+        node_proxy(csr_storage* storage, std::size_t _i, std::size_t _j) :
+            _ref{storage},
+            i{_i},
+            j{_j}
+        {}
+
+        bool operator=(bool b)
+        {
+            _ref->_pending.push_back({i, j, {}, b});
+            return b;
+        }
+
+        operator bool() const
+        {
+            return _ref->_at(i,j);
+        }
+
+        csr_storage* _ref;
+        std::size_t i, j;
+    };
+
+    std::vector<std::size_t> _offsets{0};
+    std::vector<std::size_t> _targets;
+    std::vector<csr_detail::pending_arc<csr_detail::no_payload>> _pending;
+    bool _directed = false;
+};
+
+#endif //PRACTICA2MAR_CSR_STORAGE_HPP
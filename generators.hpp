@@ -0,0 +1,252 @@
+#ifndef PRACTICA2MAR_GENERATORS_HPP
+#define PRACTICA2MAR_GENERATORS_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+
+#include "graph.hpp"
+#include "counter_rng.hpp"
+#include "thread_pool.hpp"
+
+// All generators draw from counter_rng streams keyed by row or edge index, never by
+// worker, so a given seed yields the same graph whatever the pool size.
+
+namespace generators_detail
+{
+    // Default sink: per-worker edge buffers handed to the storage in one batch
+    template<typename Storage>
+    struct edge_writer
+    {
+        edge_writer(Storage& storage, std::size_t workers) :
+            _storage(storage),
+            _buffers(workers)
+        {}
+
+        void operator()(std::size_t worker, std::size_t i, std::size_t j)
+        {
+            _buffers[worker].emplace_back(i, j);
+        }
+
+        void flush()
+        {
+            for(auto& buffer : _buffers)
+            {
+                _storage.add_edges(buffer);
+                buffer.clear();
+            }
+
+            _freeze(_storage, 0);
+        }
+
+    private:
+        template<typename S>
+        static auto _freeze(S& storage, int) -> decltype(storage.freeze(), void())
+        {
+            storage.freeze();
+        }
+
+        template<typename S>
+        static void _freeze(S&, long)
+        {}
+
+        Storage& _storage;
+        std::vector<std::vector<typename Storage::edge_t>> _buffers;
+    };
+
+    // The matrix takes concurrent writes directly with atomic word ORs
+    template<typename Observer>
+    struct edge_writer<basic_adjacency_matrix<Observer>>
+    {
+        edge_writer(basic_adjacency_matrix<Observer>& matrix, std::size_t) :
+            _matrix(matrix)
+        {}
+
+        void operator()(std::size_t, std::size_t i, std::size_t j)
+        {
+            Observer::count(graph_event::edge_write);
+            atomic_fetch_or_word(_matrix.row_words(i) + j / bits_per_word, bit_mask(j));
+
+            if(!_matrix.directed())
+                atomic_fetch_or_word(_matrix.row_words(j) + i / bits_per_word, bit_mask(i));
+        }
+
+        void flush()
+        {
+            if(_matrix.directed() && _matrix.tracks_in_edges())
+                _matrix.track_in_edges();
+        }
+
+    private:
+        basic_adjacency_matrix<Observer>& _matrix;
+    };
+
+    constexpr std::size_t edges_per_stream = 4096;
+}
+
+// G(n,p): every candidate pair is kept with probability p, visiting only the kept ones
+// by drawing geometric gaps between them
+template<typename Storage>
+void erdos_renyi(Storage& storage, double p, std::uint64_t seed, thread_pool& pool = thread_pool::default_pool())
+{
+    const std::size_t n = storage.nodes_count();
+
+    if(p <= 0.0 || n < 2)
+        return;
+
+    const double log_q = std::log1p(-std::min(p, 1.0));
+    generators_detail::edge_writer<Storage> writer{storage, pool.size()};
+
+    pool.parallel_for(0, n, 64, [&](std::size_t worker, std::size_t b, std::size_t e)
+    {
+        for(std::size_t i = b; i < e; ++i)
+        {
+            counter_rng rng{seed, i};
+            std::size_t first = storage.directed() ? 0 : i + 1;
+            std::size_t candidates = n - first - (storage.directed() ? 1 : 0);
+
+            for(std::size_t k = 0; k < candidates; ++k)
+            {
+                if(p < 1.0)
+                {
+                    double skip = std::floor(std::log(rng.uniform()) / log_q);
+
+                    if(skip >= static_cast<double>(candidates - k))
+                        break;
+
+                    k += static_cast<std::size_t>(skip);
+                }
+
+                std::size_t j = first + k;
+
+                if(storage.directed() && j >= i)
+                    ++j;
+
+                writer(worker, i, j);
+            }
+        }
+    });
+
+    writer.flush();
+}
+
+// R-MAT: each edge descends the recursive adjacency quadrants with probabilities a, b, c
+// and 1 - a - b - c. Edges falling outside nodes_count() and self loops are redrawn.
+template<typename Storage>
+void rmat(Storage& storage, std::size_t edges, std::uint64_t seed, double a = 0.57, double b = 0.19, double c = 0.19,
+          thread_pool& pool = thread_pool::default_pool())
+{
+    const std::size_t n = storage.nodes_count();
+
+    if(n < 2)
+        return;
+
+    std::size_t scale = 0;
+    while((std::size_t{1} << scale) < n)
+        ++scale;
+
+    const std::size_t streams = (edges + generators_detail::edges_per_stream - 1) / generators_detail::edges_per_stream;
+    generators_detail::edge_writer<Storage> writer{storage, pool.size()};
+
+    pool.parallel_for(0, streams, 1, [&](std::size_t worker, std::size_t begin, std::size_t end)
+    {
+        for(std::size_t stream = begin; stream < end; ++stream)
+        {
+            counter_rng rng{seed, stream};
+            std::size_t first = stream * generators_detail::edges_per_stream;
+            std::size_t last = std::min(edges, first + generators_detail::edges_per_stream);
+
+            for(std::size_t k = first; k < last; ++k)
+            {
+                std::size_t i, j;
+
+                do
+                {
+                    i = j = 0;
+
+                    for(std::size_t level = 0; level < scale; ++level)
+                    {
+                        double u = rng.uniform();
+                        bool down = u > a + b;
+                        bool right = (u > a && u <= a + b) || u > a + b + c;
+
+                        i = (i << 1) | (down ? 1 : 0);
+                        j = (j << 1) | (right ? 1 : 0);
+                    }
+                } while(i >= n || j >= n || i == j);
+
+                writer(worker, i, j);
+            }
+        }
+    });
+
+    writer.flush();
+}
+
+// Barabasi-Albert preferential attachment, generated in parallel after Sanders and
+// Schulz: edge e starts at node e / m, and its target is the endpoint found at a random
+// earlier slot of the edge list, following target slots until it reaches a source slot.
+// Every hop replays the first draw of the edge it lands on (its own counter stream), so
+// a followed target is the endpoint that edge actually got.
+template<typename Storage>
+void barabasi_albert(Storage& storage, std::size_t edges_per_node, std::uint64_t seed,
+                     thread_pool& pool = thread_pool::default_pool())
+{
+    const std::size_t n = storage.nodes_count();
+    const std::size_t m = edges_per_node;
+
+    if(n < 2 || m == 0)
+        return;
+
+    generators_detail::edge_writer<Storage> writer{storage, pool.size()};
+
+    pool.parallel_for(0, n * m, generators_detail::edges_per_stream, [&](std::size_t worker, std::size_t b, std::size_t e)
+    {
+        for(std::size_t edge = b; edge < e; ++edge)
+        {
+            std::size_t source = edge / m;
+            std::size_t current = edge;
+            std::size_t target = 0;
+
+            while(current > 0)
+            {
+                std::size_t slot = counter_rng{seed, current}.below(2 * current);
+
+                if(slot % 2 == 0)
+                {
+                    target = slot / 2 / m;
+                    break;
+                }
+
+                current = slot / 2;
+            }
+
+            if(source != target)
+                writer(worker, source, target);
+        }
+    });
+
+    writer.flush();
+}
+
+template<typename Node, typename Storage>
+void erdos_renyi(graph<Node, Storage>& g, double p, std::uint64_t seed, thread_pool& pool = thread_pool::default_pool())
+{
+    erdos_renyi(g.adjacency(), p, seed, pool);
+}
+
+template<typename Node, typename Storage>
+void rmat(graph<Node, Storage>& g, std::size_t edges, std::uint64_t seed, double a = 0.57, double b = 0.19, double c = 0.19,
+          thread_pool& pool = thread_pool::default_pool())
+{
+    rmat(g.adjacency(), edges, seed, a, b, c, pool);
+}
+
+template<typename Node, typename Storage>
+void barabasi_albert(graph<Node, Storage>& g, std::size_t edges_per_node, std::uint64_t seed,
+                     thread_pool& pool = thread_pool::default_pool())
+{
+    barabasi_albert(g.adjacency(), edges_per_node, seed, pool);
+}
+
+#endif //PRACTICA2MAR_GENERATORS_HPP
@@ -9,29 +9,123 @@
 #include <iostream>
 #include <chrono>
 #include <random>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <atomic>
+#include <thread>
 
 #include <manu343726/range/v3/all.hpp>
 #include "utils.hpp"
-
-struct adjacency_matrix {
+#include "bit_row.hpp"
+#include "aligned_allocator.hpp"
+#include "csr_storage.hpp"
+#include "counter_rng.hpp"
+#include "instrumentation.hpp"
+#include "thread_pool.hpp"
+
+constexpr std::size_t no_node = std::numeric_limits<std::size_t>::max();
+
+// Observer is the instrumentation policy (see instrumentation.hpp), null_observer by default
+template<typename Observer = null_observer>
+struct basic_adjacency_matrix {
 private:
     struct node_proxy;
 
 public:
     using edge_t = std::pair<std::size_t, std::size_t>;
+    using word_t = bit_word;
+    using observer_t = Observer;
+
+    struct edge_iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = edge_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const edge_t*;
+        using reference = edge_t;
+
+        edge_iterator() = default;
+
+        edge_iterator(const basic_adjacency_matrix* matrix, std::size_t row) :
+            _matrix{matrix},
+            _row{row}
+        {
+            if(_row < _matrix->nodes_count())
+            {
+                _column = _first_column(_row);
+                _settle();
+            }
+        }
+
+        edge_t operator*() const
+        {
+            return std::make_pair(_row, *_column);
+        }
 
-    adjacency_matrix(bool directed = false) : _directed{ directed }
+        edge_iterator& operator++()
+        {
+            ++_column;
+            _settle();
+            return *this;
+        }
+
+        edge_iterator operator++(int)
+        {
+            edge_iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        friend bool operator==(const edge_iterator& lhs, const edge_iterator& rhs)
+        {
+            return lhs._row == rhs._row && lhs._column == rhs._column;
+        }
+
+        friend bool operator!=(const edge_iterator& lhs, const edge_iterator& rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        set_bit_iterator _first_column(std::size_t row) const
+        {
+            return {_matrix->row(row), _matrix->directed() ? 0 : row};
+        }
+
+        void _settle()
+        {
+            while(_column == set_bit_iterator::end(_matrix->row(_row)))
+            {
+                if(++_row == _matrix->nodes_count())
+                {
+                    _column = {};
+                    return;
+                }
+
+                _column = _first_column(_row);
+            }
+        }
+
+        const basic_adjacency_matrix* _matrix = nullptr;
+        std::size_t _row = 0;
+        set_bit_iterator _column;
+    };
+
+    basic_adjacency_matrix(bool directed = false) : _directed{ directed }
     {}
 
-    adjacency_matrix(std::size_t nodes_count, bool directed = false) :
+    basic_adjacency_matrix(std::size_t nodes_count, bool directed = false) :
         _nodes_count{nodes_count},
+        _capacity{nodes_count},
+        _row_pitch{_pitch_for(nodes_count)},
         _directed{directed}
     {
-        _matrix.resize(nodes_count*nodes_count, false);
+        _words.resize(nodes_count * _row_pitch, 0);
     }
 
-    adjacency_matrix(std::initializer_list<std::initializer_list<int>> pairs, std::size_t nodes_count, bool directed = false) :
-        adjacency_matrix{nodes_count, directed}
+    basic_adjacency_matrix(std::initializer_list<std::initializer_list<int>> pairs, std::size_t nodes_count, bool directed = false) :
+        basic_adjacency_matrix{nodes_count, directed}
     {
         add_edges(pairs);
     }
@@ -41,43 +135,153 @@ public:
         return _directed;
     }
 
+    // Removed ids are counted until compact()
     std::size_t nodes_count() const
     {
         return _nodes_count;
     }
 
+    std::size_t capacity() const noexcept
+    {
+        return _capacity;
+    }
+
     void clear()
     {
-        for(auto e : _matrix)
-            e = false;
+        std::fill(_words.begin(), _words.end(), word_t{0});
+        std::fill(_transposed.begin(), _transposed.end(), word_t{0});
+    }
+
+    std::size_t row_pitch() const noexcept
+    {
+        return _row_pitch;
+    }
+
+    bit_row row(std::size_t node) const
+    {
+        assert(node < nodes_count());
+        return {_row_data(node), _row_pitch};
+    }
+
+    // Raw access for bulk writers; bits at columns >= nodes_count() must stay cleared.
+    // Writes through it bypass the in-edge mirror, call track_in_edges() afterwards.
+    word_t* row_words(std::size_t node)
+    {
+        assert(node < nodes_count());
+        return _row_data(node);
+    }
+
+    std::size_t degree(std::size_t node) const
+    {
+        return row(node).count();
+    }
+
+    std::size_t count_common_neighbors(std::size_t i, std::size_t j) const
+    {
+        return count_and(row(i), row(j));
+    }
+
+    std::vector<std::size_t> common_neighbors(std::size_t i, std::size_t j) const
+    {
+        std::vector<word_t> both(_row_pitch);
+        row_and(both.data(), row(i), row(j));
+
+        bit_row common{both.data(), both.size()};
+        return {set_bit_iterator{common}, set_bit_iterator::end(common)};
     }
 
     auto edges() const
     {
-        auto begin = [this](std::size_t i) -> std::size_t
-        {
-            return directed() ? 0u : i;
-        };
+        return ranges::make_iterator_range(edge_iterator{this, 0}, edge_iterator{this, nodes_count()});
+    }
 
-        return ranges::view::for_each(ranges::view::iota(0u, nodes_count() - 1), [=](std::size_t i)
-        {
-            std::size_t b = begin(i);
+    // Keeps a transposed copy of a directed matrix, updated on every edge write, so
+    // columns can be scanned as contiguous rows. Calling it again rebuilds the copy from
+    // the rows. Undirected matrices are their own transpose and keep no copy.
+    void track_in_edges()
+    {
+        if(!directed())
+            return;
 
-            return ranges::view::for_each(ranges::view::iota(b, nodes_count() - 1), [=](std::size_t j)
-            {
-                return ranges::yield_if((*this)(i,j), std::make_pair(i, j));
-            });
-        });
+        typename Observer::timer timer{graph_event::relayout};
+        Observer::count(graph_event::relayout);
+
+        _transposed.assign(_words.size(), word_t{0});
+        _mirrored = true;
+
+        for(std::size_t i = 0; i < nodes_count(); ++i)
+            for(auto j = set_bit_iterator{row(i)}; j != set_bit_iterator::end(row(i)); ++j)
+                _transposed_row(*j)[i / bits_per_word] |= bit_mask(i);
+    }
+
+    bool tracks_in_edges() const noexcept
+    {
+        return _mirrored || !directed();
+    }
+
+    // Bits of the nodes with an edge into node. Directed matrices need track_in_edges()
+    bit_row in_row(std::size_t node) const
+    {
+        assert(node < nodes_count());
+
+        if(!directed())
+            return row(node);
+        if(!_mirrored)
+            throw std::logic_error{"adjacency_matrix::in_row(): In-edges are not tracked, call track_in_edges() first"};
+
+        return {_transposed.data() + node * _row_pitch, _row_pitch};
+    }
+
+    std::size_t in_degree(std::size_t node) const
+    {
+        return in_row(node).count();
+    }
+
+    auto in_neighbors(std::size_t node) const
+    {
+        bit_row column = in_row(node);
+        return ranges::make_iterator_range(set_bit_iterator{column}, set_bit_iterator::end(column));
     }
 
     void add_edges(std::initializer_list<std::initializer_list<int>> pairs) {
         _apply_edges(pairs, true);
     }
 
+    void add_edges(const std::vector<edge_t>& edges) {
+        _apply_bulk(edges.begin(), edges.end(), true, thread_pool::default_pool());
+    }
+
+    // Bulk writes from any range or (multi-pass) iterator pair of edges, anything with
+    // first and second members. Edges are bucketed by cache-sized blocks of rows and
+    // applied block by block; large batches split the blocks across pool.
+    template<typename Iterator>
+    void add_edges(Iterator first, Iterator last, thread_pool& pool = thread_pool::default_pool()) {
+        _apply_bulk(first, last, true, pool);
+    }
+
+    template<typename Range, typename = decltype(std::begin(std::declval<const Range&>()))>
+    void add_edges(const Range& edges, thread_pool& pool = thread_pool::default_pool()) {
+        _apply_bulk(std::begin(edges), std::end(edges), true, pool);
+    }
+
     void remove_edges(std::initializer_list<std::initializer_list<int>> pairs) {
         _apply_edges(pairs, false);
     }
 
+    void remove_edges(const std::vector<edge_t>& edges) {
+        _apply_bulk(edges.begin(), edges.end(), false, thread_pool::default_pool());
+    }
+
+    template<typename Iterator>
+    void remove_edges(Iterator first, Iterator last, thread_pool& pool = thread_pool::default_pool()) {
+        _apply_bulk(first, last, false, pool);
+    }
+
+    template<typename Range, typename = decltype(std::begin(std::declval<const Range&>()))>
+    void remove_edges(const Range& edges, thread_pool& pool = thread_pool::default_pool()) {
+        _apply_bulk(std::begin(edges), std::end(edges), false, pool);
+    }
+
     void edges(std::initializer_list<std::initializer_list<int>> pairs) {
         clear();
         add_edges(pairs);
@@ -109,55 +313,287 @@ public:
 
     auto neighbors(std::size_t node) const
     {
-        return ranges::view::iota(0u, nodes_count() - 1) |
-               ranges::view::remove_if([=](int i){ return !_at(node, i); });
+        Observer::count(graph_event::neighbor_scan);
+        return ranges::make_iterator_range(set_bit_iterator{row(node)}, set_bit_iterator::end(row(node)));
     }
 
-    auto neighbors(std::size_t node)
+    void reserve(std::size_t nodes_count)
     {
-        return ranges::view::iota(0u, nodes_count() - 1) |
-               ranges::view::remove_if([=](int i){ return !_at(node, i); });
+        if(nodes_count > capacity())
+            _grow(nodes_count);
     }
 
-    void reserve(std::size_t nodes_count)
+    // Reuses the lowest removed id if there is one; returns the id of the new node
+    std::size_t add_node()
     {
-        _matrix.resize(nodes_count * nodes_count);
+        if(_free_count == 0)
+        {
+            add_nodes(1);
+            return nodes_count() - 1;
+        }
+
+        Observer::count(graph_event::node_add);
+        std::size_t w = 0;
+
+        while(_free[w] == 0)
+            ++w;
+
+        std::size_t node = w * bits_per_word + word_ctz(_free[w]);
+        _free[w] &= ~bit_mask(node);
+        --_free_count;
+        return node;
     }
 
-    void add_node()
+    void add_node(std::size_t node)
     {
-        add_node(nodes_count());
+        node = std::min(node, nodes_count());
+        Observer::count(graph_event::node_add);
+
+        if(nodes_count() == capacity())
+            _grow(_next_capacity(nodes_count() + 1));
+
+        if(node < nodes_count())
+        {
+            _insert_node(_words.data(), node);
+
+            if(_mirrored)
+                _insert_node(_transposed.data(), node);
+            if(_free_count > 0)
+                _insert_column(_free.data(), node);
+        }
+
+        ++_nodes_count;
     }
 
-    void add_node(std::size_t node)
+    // Tombstones the node: its row and column are cleared and its id is kept free for
+    // add_node(). Edge writes touching a removed id are a precondition violation until
+    // add_node() hands it out again. Costs the node's row plus its degree, except on directed matrices
+    // without tracked in-edges, where the column has to be cleared row by row.
+    void remove_node(std::size_t node)
     {
-        std::size_t new_count = nodes_count() + 1;
-        auto index  = [=](std::size_t i, std::size_t j){return i*nodes_count() + j;};
-        auto index_new = [=](std::size_t i, std::size_t j){return i*new_count + j;};
+        assert(node < nodes_count());
 
-        if(new_count* new_count < _matrix.size())
-            _matrix.resize(new_count*new_count);
+        if(removed(node))
+            throw std::logic_error{"adjacency_matrix::remove_node(): Node already removed"};
 
-        std::size_t end = node >= nodes_count() ? node + 1 : nodes_count();
+        if(!directed())
+        {
+            for(auto j = set_bit_iterator{row(node)}; j != set_bit_iterator::end(row(node)); ++j)
+                _row_data(*j)[node / bits_per_word] &= ~bit_mask(node);
+        }
+        else if(_mirrored)
+        {
+            for(auto i = set_bit_iterator{in_row(node)}; i != set_bit_iterator::end(in_row(node)); ++i)
+                _row_data(*i)[node / bits_per_word] &= ~bit_mask(node);
+            for(auto j = set_bit_iterator{row(node)}; j != set_bit_iterator::end(row(node)); ++j)
+                _transposed_row(*j)[node / bits_per_word] &= ~bit_mask(node);
 
-        for(std::size_t i = node; i < end; ++i)
+            std::fill(_transposed_row(node), _transposed_row(node) + _row_pitch, word_t{0});
+        }
+        else
         {
-            for(std::size_t j = node; j < end; ++j)
+            for(std::size_t i = 0; i < nodes_count(); ++i)
+                _row_data(i)[node / bits_per_word] &= ~bit_mask(node);
+        }
+
+        std::fill(_row_data(node), _row_data(node) + _row_pitch, word_t{0});
+
+        _free.resize(_row_pitch, word_t{0});
+        _free[node / bits_per_word] |= bit_mask(node);
+        ++_free_count;
+    }
+
+    bool removed(std::size_t node) const
+    {
+        return node / bits_per_word < _free.size() && (_free[node / bits_per_word] & bit_mask(node)) != 0;
+    }
+
+    std::size_t removed_count() const noexcept
+    {
+        return _free_count;
+    }
+
+    // Renumbers the live nodes densely, keeping their order. Returns the old to new id
+    // mapping, no_node for the removed ids.
+    std::vector<std::size_t> compact()
+    {
+        typename Observer::timer timer{graph_event::relayout};
+        Observer::count(graph_event::relayout);
+
+        std::vector<std::size_t> old_to_new(nodes_count(), no_node);
+        std::size_t live = 0;
+
+        for(std::size_t i = 0; i < nodes_count(); ++i)
+            if(!removed(i))
+                old_to_new[i] = live++;
+
+        basic_adjacency_matrix result{live, directed()};
+
+        for(std::size_t i = 0; i < nodes_count(); ++i)
+        {
+            if(removed(i))
+                continue;
+
+            word_t* target = result._row_data(old_to_new[i]);
+
+            for(auto j = set_bit_iterator{row(i)}; j != set_bit_iterator::end(row(i)); ++j)
+                target[old_to_new[*j] / bits_per_word] |= bit_mask(old_to_new[*j]);
+        }
+
+        bool mirrored = _mirrored;
+        *this = std::move(result);
+
+        if(mirrored)
+            track_in_edges();
+
+        return old_to_new;
+    }
+
+    void add_nodes(std::size_t count)
+    {
+        Observer::count(graph_event::node_add, count);
+
+        if(nodes_count() + count > capacity())
+            _grow(_next_capacity(nodes_count() + count));
+
+        _nodes_count += count;
+    }
+
+    // Edge access that many threads can share: bits are set and cleared with atomic word
+    // operations, and both halves of an undirected edge (or a directed arc and its in-edge
+    // mirror) are written under a striped per-edge lock so that racing adds and removes
+    // leave both copies agreeing.
+    // Nodes must not be added while a view is in use.
+    struct concurrent_edges
+    {
+        // Upper bound of the stripe count; small matrices get the next power of two of
+        // their node count, so short-lived views on them stay cheap to create
+        static constexpr std::size_t lock_stripes = 4096;
+
+        explicit concurrent_edges(basic_adjacency_matrix& matrix) :
+            _matrix{&matrix},
+            _locks(_stripes_for(matrix.nodes_count()))
+        {}
+
+        bool operator()(std::size_t i, std::size_t j) const
+        {
+            assert(i < _matrix->nodes_count() && j < _matrix->nodes_count());
+            return (atomic_load_word(_word(i, j)) & bit_mask(j)) != 0;
+        }
+
+        void set(std::size_t i, std::size_t j, bool value)
+        {
+            assert(i < _matrix->nodes_count() && j < _matrix->nodes_count());
+            assert(!_matrix->removed(i) && !_matrix->removed(j));
+
+            if(_matrix->directed())
             {
-                std::size_t x = (i <= node) ? i : i - 1;
-                std::size_t y = (j <= node) ? j : j - 1;
+                if(!_matrix->_mirrored)
+                    return _write(i, j, value);
+
+                std::atomic<bool>& lock = _locks[_stripe(i, j)].locked;
+                _lock(lock);
+                _write(i, j, value);
+                lock.store(false, std::memory_order_release);
+                return;
+            }
+
+            if(i == j)
+                return _write(i, j, value);
+
+            std::atomic<bool>& lock = _locks[_stripe(std::min(i, j), std::max(i, j))].locked;
+            _lock(lock);
+            _write(i, j, value);
+            _write(j, i, value);
+            lock.store(false, std::memory_order_release);
+        }
+
+        void add_edges(std::initializer_list<std::initializer_list<int>> pairs)
+        {
+            _apply_edges(pairs, true);
+        }
+
+        void add_edges(const std::vector<edge_t>& edges)
+        {
+            for(const auto& edge : edges)
+                set(edge.first, edge.second, true);
+        }
+
+        void remove_edges(std::initializer_list<std::initializer_list<int>> pairs)
+        {
+            _apply_edges(pairs, false);
+        }
+
+    private:
+        bit_word* _word(std::size_t i, std::size_t j) const
+        {
+            return _matrix->_row_data(i) + j / bits_per_word;
+        }
+
+        void _write(std::size_t i, std::size_t j, bool value)
+        {
+            Observer::count(graph_event::edge_write);
+            _write(_word(i, j), bit_mask(j), value);
+
+            if(_matrix->_mirrored)
+                _write(_matrix->_transposed_row(j) + i / bits_per_word, bit_mask(i), value);
+        }
+
+        static void _write(bit_word* word, bit_word mask, bool value)
+        {
+            if(value)
+                atomic_fetch_or_word(word, mask);
+            else
+                atomic_fetch_and_word(word, ~mask);
+        }
+
+        static void _lock(std::atomic<bool>& lock)
+        {
+            while(lock.exchange(true, std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+        static std::size_t _stripes_for(std::size_t nodes_count)
+        {
+            std::size_t stripes = 1;
 
-                if(i == node || j == node)
-                    _matrix[index_new(i,j)] = false;
-                else if(i > node || j > node)
-                    _matrix[index_new(i,j)] = _matrix[index(x,y)];
+            while(stripes < nodes_count && stripes < lock_stripes)
+                stripes *= 2;
+
+            return stripes;
+        }
+
+        std::size_t _stripe(std::size_t low, std::size_t high) const
+        {
+            return static_cast<std::size_t>(counter_rng::mix(low * 0x9e3779b97f4a7c15ull ^ high)) & (_locks.size() - 1);
+        }
+
+        void _apply_edges(std::initializer_list<std::initializer_list<int>> pairs, bool value)
+        {
+            for(auto pair : pairs)
+            {
+                assert(std::end(pair) - std::begin(pair) == 2);
+                set(*(std::begin(pair)), *(std::begin(pair) + 1), value);
             }
         }
 
-        _nodes_count = new_count;
+        // One stripe per cache line, so threads spinning on different stripes do not
+        // bounce a shared line
+        struct alignas(64) lock_stripe
+        {
+            std::atomic<bool> locked{false};
+        };
+
+        basic_adjacency_matrix* _matrix;
+        std::vector<lock_stripe, aligned_allocator<lock_stripe>> _locks;
+    };
+
+    concurrent_edges concurrent_view()
+    {
+        return concurrent_edges{*this};
     }
 
-    friend std::ostream& operator<<(std::ostream& os, const adjacency_matrix& m)
+    friend std::ostream& operator<<(std::ostream& os, const basic_adjacency_matrix& m)
     {
         for(std::size_t i = 0; i < m.nodes_count(); ++i)
         {
@@ -186,36 +622,278 @@ private:
         }
     }
 
+    template<typename Iterator>
+    void _apply_bulk(Iterator first, Iterator last, bool value, thread_pool& pool)
+    {
+        typename Observer::timer timer{graph_event::edge_write};
+        _write_arcs(_words.data(), first, last, false, value, pool);
+
+        if(_mirrored)
+            _write_arcs(_transposed.data(), first, last, true, value, pool);
+    }
+
+    // A single writer, a matrix that fits in the last level cache or a batch that leaves
+    // most of its cache lines untouched gain nothing from sorting: those arcs are written
+    // in input order (atomically when several workers share the input). For one writer,
+    // sorting by word and folding the masks costs about four times the direct writes
+    // (bulk_write_* in benchmark.cpp). Dense batches on
+    // large matrices are counting-sorted by block of rows instead (per-worker histograms
+    // over contiguous slices of the input, arcs packed as row << 32 | column), with blocks
+    // sized so their rows stay in L2 while the block's arcs are folded in: workers own
+    // disjoint rows, and every touched word goes through memory once.
+    template<typename Iterator>
+    void _write_arcs(word_t* words, Iterator first, Iterator last, bool transpose, bool value, thread_pool& pool)
+    {
+        constexpr std::size_t block_words = std::size_t{1} << 15;
+        constexpr std::size_t cached_words = std::size_t{1} << 22;
+        constexpr std::size_t parallel_threshold = std::size_t{1} << 16;
+        assert(nodes_count() <= std::numeric_limits<std::uint32_t>::max());
+
+        const std::size_t count = static_cast<std::size_t>(std::distance(first, last));
+        // Locals, since the word writes could otherwise alias the members
+        const std::size_t pitch = _row_pitch, n = nodes_count();
+        const bool undirected = !directed();
+        const std::size_t matrix_words = n * pitch;
+        const std::size_t workers = count < parallel_threshold ? 1 : pool.size();
+
+        auto for_slices = [&](auto f)
+        {
+            auto job = [&](std::size_t worker)
+            {
+                f(worker, std::next(first, count * worker / workers), std::next(first, count * (worker + 1) / workers));
+            };
+
+            if(workers == 1)
+                job(0);
+            else
+                pool.run(job);
+        };
+
+        auto for_arcs = [&](Iterator b, Iterator e, auto f)
+        {
+            for(; b != e; ++b)
+            {
+                auto edge = *b;
+                std::size_t i = edge.first, j = edge.second;
+                assert(i < n && j < n && !removed(i) && !removed(j));
+
+                if(transpose)
+                    std::swap(i, j);
+
+                f(i, j);
+
+                if(undirected && i != j)
+                    f(j, i);
+            }
+        };
+
+        if(workers == 1 || matrix_words <= cached_words || count * words_per_cache_line < matrix_words)
+        {
+            if(!transpose)
+                Observer::count(graph_event::edge_write, undirected ? 2 * count : count);
+
+            if(workers == 1 && value)
+                for_arcs(first, last, [=](std::size_t i, std::size_t j) { words[i * pitch + j / bits_per_word] |= bit_mask(j); });
+            else if(workers == 1)
+                for_arcs(first, last, [=](std::size_t i, std::size_t j) { words[i * pitch + j / bits_per_word] &= ~bit_mask(j); });
+            else
+            {
+                for_slices([&](std::size_t, Iterator b, Iterator e)
+                {
+                    for_arcs(b, e, [=](std::size_t i, std::size_t j)
+                    {
+                        word_t* word = words + i * pitch + j / bits_per_word;
+                        value ? atomic_fetch_or_word(word, bit_mask(j)) : atomic_fetch_and_word(word, ~bit_mask(j));
+                    });
+                });
+            }
+
+            return;
+        }
+
+        const std::size_t rows_per_block = std::max<std::size_t>(1, block_words / std::max<std::size_t>(pitch, 1));
+        const std::size_t blocks = (n + rows_per_block - 1) / rows_per_block;
+        std::vector<std::size_t> offsets(workers * blocks, 0), block_begin(blocks + 1, 0);
+
+        for_slices([&](std::size_t worker, Iterator b, Iterator e)
+        {
+            for_arcs(b, e, [&](std::size_t i, std::size_t)
+            {
+                ++offsets[worker * blocks + i / rows_per_block];
+            });
+        });
+
+        std::size_t total = 0;
+
+        for(std::size_t block = 0; block < blocks; ++block)
+        {
+            block_begin[block] = total;
+
+            for(std::size_t worker = 0; worker < workers; ++worker)
+            {
+                std::size_t arcs = offsets[worker * blocks + block];
+                offsets[worker * blocks + block] = total;
+                total += arcs;
+            }
+        }
+
+        block_begin[blocks] = total;
+        std::vector<std::uint64_t> sorted(total);
+
+        if(!transpose)
+            Observer::count(graph_event::edge_write, total);
+
+        for_slices([&](std::size_t worker, Iterator b, Iterator e)
+        {
+            for_arcs(b, e, [&](std::size_t i, std::size_t j)
+            {
+                sorted[offsets[worker * blocks + i / rows_per_block]++] = (std::uint64_t{i} << 32) | j;
+            });
+        });
+
+        auto apply_blocks = [&](std::size_t, std::size_t b, std::size_t e)
+        {
+            for(std::size_t block = b; block < e; ++block)
+            {
+                for(std::size_t k = block_begin[block]; k < block_begin[block + 1]; ++k)
+                {
+                    std::size_t i = static_cast<std::size_t>(sorted[k] >> 32), j = static_cast<std::size_t>(sorted[k] & 0xffffffffu);
+                    word_t& word = words[i * pitch + j / bits_per_word];
+                    word = value ? (word | bit_mask(j)) : (word & ~bit_mask(j));
+                }
+            }
+        };
+
+        if(workers == 1)
+            apply_blocks(0, 0, blocks);
+        else
+            pool.parallel_for(0, blocks, 1, apply_blocks);
+    }
+
     auto _row_indices(std::size_t row) const
     {
         return ranges::view::iota(0u, nodes_count() - 1) |
-               ranges::view::transform([=](std::size_t i){ return nodes_count() * row + i; });
+               ranges::view::transform([=](std::size_t i){ return _row_pitch * bits_per_word * row + i; });
     }
 
     auto _column_indices(std::size_t column) const
     {
         return ranges::view::iota(0u, nodes_count() - 1) |
-               ranges::view::transform([=](std::size_t i){ return nodes_count() * i + column; });
+               ranges::view::transform([=](std::size_t i){ return _row_pitch * bits_per_word * i + column; });
+    }
+
+    using storage_t = std::vector<word_t, aligned_allocator<word_t>>;
+
+    static std::size_t _pitch_for(std::size_t nodes_count)
+    {
+        return round_to_cache_line(words_for_bits(nodes_count));
+    }
+
+    std::size_t _next_capacity(std::size_t required) const
+    {
+        return std::max({required, 2 * capacity(), std::size_t{64}});
+    }
+
+    // Rows and columns past nodes_count() are kept zeroed, so growing only has to
+    // copy the live rows into the wider pitch
+    void _grow(std::size_t new_capacity)
+    {
+        typename Observer::timer timer{graph_event::relayout};
+        Observer::count(graph_event::relayout);
+
+        std::size_t new_pitch = _pitch_for(new_capacity);
+        storage_t words(new_capacity * new_pitch, 0);
+
+        for(std::size_t i = 0; i < nodes_count(); ++i)
+            std::copy(_row_data(i), _row_data(i) + _row_pitch, words.data() + i * new_pitch);
+
+        if(_mirrored)
+        {
+            storage_t transposed(new_capacity * new_pitch, 0);
+
+            for(std::size_t i = 0; i < nodes_count(); ++i)
+                std::copy(_transposed_row(i), _transposed_row(i) + _row_pitch, transposed.data() + i * new_pitch);
+
+            _transposed = std::move(transposed);
+        }
+
+        if(!_free.empty())
+            _free.resize(new_pitch, word_t{0});
+
+        _words = std::move(words);
+        _capacity = new_capacity;
+        _row_pitch = new_pitch;
+    }
+
+    // Makes room for a node at the given position in a square bit matrix laid out like _words
+    void _insert_node(word_t* words, std::size_t node) const
+    {
+        std::copy_backward(words + node * _row_pitch, words + nodes_count() * _row_pitch, words + (nodes_count() + 1) * _row_pitch);
+        std::fill(words + node * _row_pitch, words + (node + 1) * _row_pitch, word_t{0});
+
+        for(std::size_t i = 0; i <= nodes_count(); ++i)
+            _insert_column(words + i * _row_pitch, node);
+    }
+
+    word_t* _transposed_row(std::size_t row)
+    {
+        return _transposed.data() + row * _row_pitch;
+    }
+
+    const word_t* _row_data(std::size_t row) const
+    {
+        return _words.data() + row * _row_pitch;
     }
 
-    std::size_t _index_from_coords(std::size_t i, std::size_t j) const
+    word_t* _row_data(std::size_t row)
     {
-        return i * nodes_count() + j;
+        return _words.data() + row * _row_pitch;
     }
 
     bool _at(std::size_t i, std::size_t j) const
     {
-        return _matrix[_index_from_coords(i,j)];
+        return (_row_data(i)[j / bits_per_word] & bit_mask(j)) != 0;
+    }
+
+    void _set(std::size_t i, std::size_t j, bool value)
+    {
+        assert(!removed(i) && !removed(j));
+        Observer::count(graph_event::edge_write);
+        _set_bit(_row_data(i)[j / bits_per_word], bit_mask(j), value);
+
+        if(_mirrored)
+            _set_bit(_transposed_row(j)[i / bits_per_word], bit_mask(i), value);
+    }
+
+    static void _set_bit(word_t& word, word_t mask, bool value)
+    {
+        if(value)
+            word |= mask;
+        else
+            word &= ~mask;
     }
 
-    std::vector<bool>::reference _at(std::size_t i, std::size_t j)
+    // Shifts the columns at and after the given one by one position, in place
+    void _insert_column(word_t* row, std::size_t column) const
     {
-        return _matrix[_index_from_coords(i,j)];
+        std::size_t split = column / bits_per_word;
+        word_t low = bit_mask(column) - 1;
+
+        for(std::size_t w = _row_pitch; w-- > split;)
+        {
+            word_t previous = (w > 0) ? row[w - 1] : 0;
+            word_t shifted = (row[w] << 1) | (previous >> (bits_per_word - 1));
+
+            if(w == split)
+                row[w] = (row[w] & low) | (shifted & ~low & ~bit_mask(column));
+            else
+                row[w] = shifted;
+        }
     }
 
     struct node_proxy
     {
-        node_proxy(adjacency_matrix* matrix, std::size_t _i, std::size_t _j) :
+        node_proxy(basic_adjacency_matrix* matrix, std::size_t _i, std::size_t _j) :
             _ref{matrix},
             i{_i},
             j{_j}
@@ -223,25 +901,40 @@ private:
 
         bool operator=(bool b)
         {
-            _ref->_at(i,j)= b;
+            _ref->_set(i,j,b);
 
             if(!_ref->directed())
-                _ref->_at(j,i) = b;
+                _ref->_set(j,i,b);
 
             return b;
         }
 
-        adjacency_matrix* _ref;
+        operator bool() const
+        {
+            return _ref->_at(i,j);
+        }
+
+        basic_adjacency_matrix* _ref;
         std::size_t i, j;
     };
 
-    std::vector<bool> _matrix;
+    storage_t _words;
+    storage_t _transposed;
+    bool _mirrored = false;
+    std::vector<word_t> _free;
+    std::size_t _free_count = 0;
     std::size_t _nodes_count = 0;
+    std::size_t _capacity = 0;
+    std::size_t _row_pitch = 0;
     bool _directed = false;
 };
 
-template<typename Node>
+using adjacency_matrix = basic_adjacency_matrix<>;
+
+template<typename Node, typename Storage = adjacency_matrix>
 struct graph {
+    using storage_t = Storage;
+
     graph(bool directed = false) : _matrix{ directed }
     {};
 
@@ -288,16 +981,67 @@ struct graph {
         _nodes.reserve(count);
     }
 
+    // Returns the id of the new node, a removed one when the storage reuses them
     template<typename... Args>
-    void add_node(Args&&... args)
+    std::size_t add_node(Args&&... args)
     {
-        _nodes.emplace_back(nodes_count(), std::forward<Args>(args)...);
-        _matrix.add_node();
+        return _add_node(_matrix, 0, std::forward<Args>(args)...);
+    }
+
+    // Tombstones the node, see adjacency_matrix::remove_node(). Once the removed ids go
+    // over the compaction threshold the graph is compacted right away and the id mapping
+    // returned; otherwise the result is empty.
+    std::vector<std::size_t> remove_node(std::size_t node)
+    {
+        _matrix.remove_node(node);
+
+        if(_compaction_threshold > 0.0 && _matrix.removed_count() > _compaction_threshold * nodes_count())
+            return compact();
+
+        return {};
+    }
+
+    bool removed(std::size_t node) const
+    {
+        return _matrix.removed(node);
+    }
+
+    // Fraction of removed ids that triggers compact() from remove_node(), 0 to disable
+    void compaction_threshold(double fraction)
+    {
+        _compaction_threshold = fraction;
+    }
+
+    // Renumbers the live nodes densely, returns the old to new id mapping (no_node for
+    // the removed ones)
+    std::vector<std::size_t> compact()
+    {
+        std::vector<std::size_t> old_to_new = _matrix.compact();
+        std::vector<node_t> nodes;
+        nodes.reserve(_matrix.nodes_count());
+
+        for(std::size_t i = 0; i < old_to_new.size(); ++i)
+            if(old_to_new[i] != no_node)
+                nodes.emplace_back(old_to_new[i], std::move(static_cast<Node&>(_nodes[i])));
+
+        _nodes = std::move(nodes);
+        return old_to_new;
+    }
+
+    template<typename... Args>
+    void add_nodes(std::size_t count, const Args&... args)
+    {
+        _nodes.reserve(nodes_count() + count);
+
+        for(std::size_t i = 0; i < count; ++i)
+            _nodes.emplace_back(nodes_count(), args...);
+
+        _matrix.add_nodes(count);
     }
 
     auto neighbors(std::size_t node) const
     {
-        return ranges::view::transform(_matrix.neighbors(node), [this](std::size_t i)
+        return ranges::view::transform(_matrix.neighbors(node), [this](std::size_t i) -> const node_t&
         {
             return _nodes[i];
         }) | ranges::view::bounded;
@@ -319,12 +1063,12 @@ struct graph {
         });
     }
 
-    const adjacency_matrix& adjacency() const
+    const Storage& adjacency() const
     {
         return _matrix;
     }
 
-    adjacency_matrix& adjacency()
+    Storage& adjacency()
     {
         return _matrix;
     }
@@ -339,7 +1083,7 @@ struct graph {
         return _matrix(a.id(), b.id());
     }
 
-    node_t operator()(std::size_t i) const
+    const node_t& operator()(std::size_t i) const
     {
         return _nodes[i];
     }
@@ -352,7 +1096,7 @@ struct graph {
     auto nodes() const
     {
         return ranges::view::iota(0, nodes_count()-1) |
-        ranges::view::transform([this](std::size_t i)
+        ranges::view::transform([this](std::size_t i) -> const node_t&
         {
            return (*this)(i);
         });
@@ -367,13 +1111,105 @@ struct graph {
         });
     }
 
+    // Removed ids are counted until compact(). The algorithms over a graph (pagerank,
+    // components, snapshots...) do not skip them either, compact() before running those.
     std::size_t nodes_count() const
     {
         return _nodes.size();
     }
+
+    std::size_t degree(std::size_t node) const
+    {
+        return _matrix.degree(node);
+    }
+
+    std::size_t count_common_neighbors(std::size_t i, std::size_t j) const
+    {
+        return _matrix.count_common_neighbors(i, j);
+    }
+
+    std::size_t in_degree(std::size_t node) const
+    {
+        return _matrix.in_degree(node);
+    }
+
+    auto in_neighbors(std::size_t node) const
+    {
+        return ranges::view::transform(_matrix.in_neighbors(node), [this](std::size_t i) -> const node_t&
+        {
+            return _nodes[i];
+        }) | ranges::view::bounded;
+    }
+
+    std::vector<node_t> common_neighbors(std::size_t i, std::size_t j) const
+    {
+        std::vector<node_t> result;
+
+        for(std::size_t k : _matrix.common_neighbors(i, j))
+            result.push_back(_nodes[k]);
+
+        return result;
+    }
+
+    void freeze()
+    {
+        _matrix.freeze();
+    }
+
+    // Moves node i to old_to_new[i], payload included. storage must already hold the
+    // adjacency renumbered the same way (see reorder.hpp)
+    void relabel(const std::vector<std::size_t>& old_to_new, Storage storage)
+    {
+        assert(old_to_new.size() == nodes_count() && storage.nodes_count() == nodes_count());
+        std::vector<std::size_t> new_to_old(nodes_count());
+        std::vector<node_t> nodes;
+        nodes.reserve(nodes_count());
+
+        for(std::size_t i = 0; i < nodes_count(); ++i)
+            new_to_old[old_to_new[i]] = i;
+
+        for(std::size_t k = 0; k < nodes_count(); ++k)
+            nodes.emplace_back(k, static_cast<const Node&>(_nodes[new_to_old[k]]));
+
+        _nodes = std::move(nodes);
+        _matrix = std::move(storage);
+    }
+
+    // Versioned storages only: consistent read-only view of the last published state
+    auto snapshot() const
+    {
+        return _matrix.snapshot();
+    }
+
+    void publish()
+    {
+        _matrix.publish();
+    }
 private:
+    template<typename S, typename... Args>
+    auto _add_node(S& storage, int, Args&&... args) -> decltype(storage.remove_node(0), std::size_t())
+    {
+        std::size_t id = storage.add_node();
+
+        if(id < _nodes.size())
+            _nodes[id] = node_t{id, std::forward<Args>(args)...};
+        else
+            _nodes.emplace_back(id, std::forward<Args>(args)...);
+
+        return id;
+    }
+
+    template<typename S, typename... Args>
+    std::size_t _add_node(S& storage, long, Args&&... args)
+    {
+        _nodes.emplace_back(nodes_count(), std::forward<Args>(args)...);
+        storage.add_node();
+        return nodes_count() - 1;
+    }
+
     std::vector<node_t> _nodes;
-    adjacency_matrix _matrix;
+    Storage _matrix;
+    double _compaction_threshold = 0.0;
 
 public:
     METHOD_FROM(directed, _matrix)
@@ -384,39 +1220,37 @@ public:
 };
 
 template<typename Node, bool node_debug_output = false, bool edge_debug_output = false>
-auto random_graph(std::size_t nodes, float density)
+auto random_graph(std::size_t nodes, float density, std::uint64_t seed = std::random_device{}())
 {
     std::chrono::high_resolution_clock::time_point begin;
-    std::mt19937 prng{ std::random_device{}() };
-    std::uniform_int_distribution<std::size_t> dist{0, nodes-1};
+    std::size_t passes = static_cast<std::size_t>(std::ceil(density));
 
     graph<Node> result;
     result.reserve(nodes);
 
-    for(std::size_t i = 0; i < nodes; ++i)
+    if(!node_debug_output)
+        result.add_nodes(nodes);
+
+    for(std::size_t i = 0; node_debug_output && i < nodes; ++i)
     {
-        if(node_debug_output)
-        {
-            std::cout << "Adding node (" << i << ")... ";
-            begin = std::chrono::high_resolution_clock::now();
-        }
+        std::cout << "Adding node (" << i << ")... ";
+        begin = std::chrono::high_resolution_clock::now();
         result.add_node();
-        if(node_debug_output)
-        {
-            auto end = std::chrono::high_resolution_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin);
-            std::cout <<  elapsed.count() << "ms\n";
-        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin);
+        std::cout <<  elapsed.count() << "ms\n";
     }
 
-    for(std::size_t i = 0; i < density; ++i)
+    for(std::size_t i = 0; i < passes; ++i)
     {
         if(edge_debug_output)
             std::cout << "Generating edges (Pass " << i << ")\n";
 
+        counter_rng prng{seed, i};
+
         for(std::size_t j = 0; j < nodes; ++j)
         {
-            std::size_t k = dist(prng);
+            std::size_t k = prng.below(nodes);
 
             if(k != j)
                 result(j,k) = true;
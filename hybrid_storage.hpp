@@ -0,0 +1,1117 @@
+#ifndef PRACTICA2MAR_HYBRID_STORAGE_HPP
+#define PRACTICA2MAR_HYBRID_STORAGE_HPP
+
+#include <cstdint>
+#include <utility>
+#include <iterator>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+
+#include <manu343726/range/v3/all.hpp>
+#include "bit_row.hpp"
+
+enum class row_container
+{
+    array,
+    bitset,
+    run
+};
+
+namespace hybrid_detail
+{
+    // Bits [first, last] of a word, both in the same word
+    inline bit_word bits_between(std::size_t first, std::size_t last)
+    {
+        assert(first <= last && last % bits_per_word >= first % bits_per_word);
+        return (~bit_word{0} << (first % bits_per_word)) & (~bit_word{0} >> (bits_per_word - 1 - last % bits_per_word));
+    }
+
+    // Row kernels report their result in increasing order through a sink with three entry
+    // points: one value, an inclusive range of values and the set bits of a bitset word.
+    // Several word() calls may share an index, each one with later bits.
+    struct count_sink
+    {
+        void value(std::size_t)
+        {
+            ++count;
+        }
+
+        void range(std::size_t first, std::size_t last)
+        {
+            count += last - first + 1;
+        }
+
+        void word(std::size_t, bit_word w)
+        {
+            count += word_popcount(w);
+        }
+
+        std::size_t count = 0;
+    };
+
+    struct vector_sink
+    {
+        void value(std::size_t x)
+        {
+            out.push_back(x);
+        }
+
+        void range(std::size_t first, std::size_t last)
+        {
+            for(std::size_t x = first; x <= last; ++x)
+                out.push_back(x);
+        }
+
+        void word(std::size_t index, bit_word w)
+        {
+            for(; w != 0; w &= w - 1)
+                out.push_back(index * bits_per_word + word_ctz(w));
+        }
+
+        std::vector<std::size_t>& out;
+    };
+}
+
+// One adjacency row as a Roaring container: a sorted array of ids, a bitset or a sorted
+// list of [first, last] runs. The cardinality and the number of runs are kept up to date
+// on every write (a write only looks at the neighbors of the id), so the size of each
+// layout is known without scanning the row.
+struct hybrid_row
+{
+    using value_t = std::uint32_t;
+
+    struct iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::size_t*;
+        using reference = std::size_t;
+
+        iterator() = default;
+
+        iterator(const hybrid_row& row, bool end) :
+            _kind{row._kind}
+        {
+            switch(_kind)
+            {
+            case row_container::array:
+                _p = row._values.data() + (end ? row._values.size() : 0);
+                break;
+            case row_container::bitset:
+                _bits = end ? set_bit_iterator::end(row._bit_row()) : set_bit_iterator{row._bit_row()};
+                break;
+            case row_container::run:
+                _p = row._values.data() + (end ? row._values.size() : 0);
+                _end = row._values.data() + row._values.size();
+                _current = _p != _end ? _p[0] : 0;
+                break;
+            }
+        }
+
+        std::size_t operator*() const
+        {
+            switch(_kind)
+            {
+            case row_container::array:
+                return *_p;
+            case row_container::bitset:
+                return *_bits;
+            default:
+                return _current;
+            }
+        }
+
+        iterator& operator++()
+        {
+            switch(_kind)
+            {
+            case row_container::array:
+                ++_p;
+                break;
+            case row_container::bitset:
+                ++_bits;
+                break;
+            case row_container::run:
+                if(_current < _p[1])
+                    ++_current;
+                else
+                {
+                    _p += 2;
+                    _current = _p != _end ? _p[0] : 0;
+                }
+                break;
+            }
+
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        friend bool operator==(const iterator& lhs, const iterator& rhs)
+        {
+            return lhs._p == rhs._p && lhs._current == rhs._current && lhs._bits == rhs._bits;
+        }
+
+        friend bool operator!=(const iterator& lhs, const iterator& rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        row_container _kind = row_container::array;
+        const value_t* _p = nullptr;
+        const value_t* _end = nullptr;
+        std::size_t _current = 0;
+        set_bit_iterator _bits;
+    };
+
+    row_container kind() const noexcept
+    {
+        return _kind;
+    }
+
+    std::size_t cardinality() const noexcept
+    {
+        return _cardinality;
+    }
+
+    std::size_t runs() const noexcept
+    {
+        return _runs;
+    }
+
+    iterator begin() const
+    {
+        return {*this, false};
+    }
+
+    iterator end() const
+    {
+        return {*this, true};
+    }
+
+    // Bytes the row takes in each layout
+    std::size_t bytes(row_container kind) const
+    {
+        switch(kind)
+        {
+        case row_container::array:
+            return _cardinality * sizeof(value_t);
+        case row_container::bitset:
+            return _cardinality ? words_for_bits(_max() + 1) * sizeof(bit_word) : 0;
+        default:
+            return _runs * 2 * sizeof(value_t);
+        }
+    }
+
+    std::size_t bytes() const
+    {
+        return _kind == row_container::bitset ? _bits.size() * sizeof(bit_word) : _values.size() * sizeof(value_t);
+    }
+
+    bool test(std::size_t x) const
+    {
+        switch(_kind)
+        {
+        case row_container::array:
+            return std::binary_search(_values.begin(), _values.end(), static_cast<value_t>(x));
+        case row_container::bitset:
+            return x / bits_per_word < _bits.size() && (_bits[x / bits_per_word] & bit_mask(x)) != 0;
+        default:
+            return _run_at(x) < _values.size();
+        }
+    }
+
+    // Both return whether the row changed
+    bool set(std::size_t x)
+    {
+        assert(x < std::numeric_limits<value_t>::max());
+
+        if(test(x))
+            return false;
+
+        _runs = _runs + 1 - (x > 0 && test(x - 1)) - test(x + 1);
+        ++_cardinality;
+
+        switch(_kind)
+        {
+        case row_container::array:
+            _values.insert(std::lower_bound(_values.begin(), _values.end(), static_cast<value_t>(x)), static_cast<value_t>(x));
+            break;
+        case row_container::bitset:
+            if(x / bits_per_word >= _bits.size())
+                _bits.resize(x / bits_per_word + 1, 0);
+
+            _bits[x / bits_per_word] |= bit_mask(x);
+            break;
+        case row_container::run:
+            _insert_run_value(static_cast<value_t>(x));
+            break;
+        }
+
+        return true;
+    }
+
+    bool reset(std::size_t x)
+    {
+        if(!test(x))
+            return false;
+
+        _runs = _runs - 1 + (x > 0 && test(x - 1)) + test(x + 1);
+        --_cardinality;
+
+        switch(_kind)
+        {
+        case row_container::array:
+            _values.erase(std::lower_bound(_values.begin(), _values.end(), static_cast<value_t>(x)));
+            break;
+        case row_container::bitset:
+            _bits[x / bits_per_word] &= ~bit_mask(x);
+
+            while(!_bits.empty() && _bits.back() == 0)
+                _bits.pop_back();
+            break;
+        case row_container::run:
+            _erase_run_value(static_cast<value_t>(x));
+            break;
+        }
+
+        return true;
+    }
+
+    // Switches to the smallest layout once it saves a quarter of the current one, so a
+    // row sitting at a threshold does not convert back and forth on every write
+    void adapt()
+    {
+        row_container best = row_container::array;
+
+        for(row_container kind : {row_container::bitset, row_container::run})
+            if(bytes(kind) < bytes(best))
+                best = kind;
+
+        if(best != _kind && bytes(best) * 4 < bytes(_kind) * 3)
+            convert(best);
+    }
+
+    void convert(row_container kind)
+    {
+        if(kind == _kind)
+            return;
+
+        std::vector<value_t> values;
+        std::vector<bit_word> bits;
+
+        switch(kind)
+        {
+        case row_container::array:
+            values.reserve(_cardinality);
+            for_each([&](std::size_t x){ values.push_back(static_cast<value_t>(x)); });
+            break;
+        case row_container::bitset:
+            bits.assign(_cardinality ? words_for_bits(_max() + 1) : 0, 0);
+            for_each_run([&](std::size_t first, std::size_t last)
+            {
+                for(std::size_t w = first / bits_per_word; w <= last / bits_per_word; ++w)
+                    bits[w] |= hybrid_detail::bits_between(std::max(first, w * bits_per_word),
+                                                           std::min(last, w * bits_per_word + bits_per_word - 1));
+            });
+            break;
+        case row_container::run:
+            values.reserve(2 * _runs);
+            for_each_run([&](std::size_t first, std::size_t last)
+            {
+                values.push_back(static_cast<value_t>(first));
+                values.push_back(static_cast<value_t>(last));
+            });
+            break;
+        }
+
+        _kind = kind;
+        _values = std::move(values);
+        _bits = std::move(bits);
+    }
+
+    template<typename F>
+    void for_each(F f) const
+    {
+        for(std::size_t x : *this)
+            f(x);
+    }
+
+    // Maximal runs of consecutive ids, in increasing order
+    template<typename F>
+    void for_each_run(F f) const
+    {
+        if(_kind == row_container::run)
+        {
+            for(std::size_t k = 0; k < _values.size(); k += 2)
+                f(std::size_t{_values[k]}, std::size_t{_values[k + 1]});
+
+            return;
+        }
+
+        bool open = false;
+        std::size_t first = 0, last = 0;
+
+        for_each([&](std::size_t x)
+        {
+            if(open && x == last + 1)
+                last = x;
+            else
+            {
+                if(open)
+                    f(first, last);
+
+                first = last = x;
+                open = true;
+            }
+        });
+
+        if(open)
+            f(first, last);
+    }
+
+    // Raw layouts, for the row kernels
+    const std::vector<value_t>& values() const noexcept
+    {
+        return _values;
+    }
+
+    bit_row bits() const noexcept
+    {
+        return _bit_row();
+    }
+
+private:
+    bit_row _bit_row() const
+    {
+        return {_bits.data(), _bits.size()};
+    }
+
+    std::size_t _max() const
+    {
+        assert(_cardinality > 0);
+
+        if(_kind == row_container::bitset)
+            return (_bits.size() - 1) * bits_per_word + word_bit_width(_bits.back()) - 1;
+
+        return _values.back();
+    }
+
+    // Number of runs starting at or before x
+    std::size_t _runs_up_to(std::size_t x) const
+    {
+        std::size_t lo = 0, hi = _values.size() / 2;
+
+        while(lo < hi)
+        {
+            std::size_t mid = lo + (hi - lo) / 2;
+
+            if(_values[2 * mid] <= x)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        return lo;
+    }
+
+    // Index of the first of the run holding x, or the size of the run list
+    std::size_t _run_at(std::size_t x) const
+    {
+        std::size_t runs = _runs_up_to(x);
+        return runs > 0 && x <= _values[2 * runs - 1] ? 2 * (runs - 1) : _values.size();
+    }
+
+    void _insert_run_value(value_t x)
+    {
+        auto next = _values.begin() + 2 * _runs_up_to(x);
+        bool joins_prev = next != _values.begin() && *(next - 1) + 1 == x;
+        bool joins_next = next != _values.end() && *next == x + 1;
+
+        if(joins_prev && joins_next)
+        {
+            *(next - 1) = *(next + 1);
+            _values.erase(next, next + 2);
+        }
+        else if(joins_prev)
+            *(next - 1) = x;
+        else if(joins_next)
+            *next = x;
+        else
+            _values.insert(next, {x, x});
+    }
+
+    void _erase_run_value(value_t x)
+    {
+        std::size_t k = _run_at(x);
+        value_t first = _values[k], last = _values[k + 1];
+
+        if(first == last)
+            _values.erase(_values.begin() + k, _values.begin() + k + 2);
+        else if(x == first)
+            ++_values[k];
+        else if(x == last)
+            --_values[k + 1];
+        else
+        {
+            _values[k + 1] = x - 1;
+            _values.insert(_values.begin() + k + 2, {x + 1, last});
+        }
+    }
+
+    row_container _kind = row_container::array;
+    std::size_t _cardinality = 0;
+    std::size_t _runs = 0;
+    // Sorted ids (array) or first, last pairs (run)
+    std::vector<value_t> _values;
+    std::vector<bit_word> _bits;
+};
+
+namespace hybrid_detail
+{
+    using value_t = hybrid_row::value_t;
+    using values_t = std::vector<value_t>;
+
+    inline bool test(bit_row bits, std::size_t x)
+    {
+        return x / bits_per_word < bits.words && bits.test(x);
+    }
+
+    template<typename Sink>
+    void intersect_arrays(const values_t& a, const values_t& b, Sink& sink)
+    {
+        const values_t& small = a.size() <= b.size() ? a : b;
+        const values_t& large = a.size() <= b.size() ? b : a;
+
+        // Skewed sizes: binary search every small value in what is left of the large array
+        if(small.size() * 32 < large.size())
+        {
+            auto from = large.begin();
+
+            for(value_t x : small)
+            {
+                from = std::lower_bound(from, large.end(), x);
+
+                if(from == large.end())
+                    return;
+                if(*from == x)
+                    sink.value(x);
+            }
+
+            return;
+        }
+
+        for(auto i = a.begin(), j = b.begin(); i != a.end() && j != b.end(); )
+        {
+            if(*i < *j)
+                ++i;
+            else if(*j < *i)
+                ++j;
+            else
+            {
+                sink.value(*i);
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    template<typename Sink>
+    void intersect_array_bitset(const values_t& a, bit_row b, Sink& sink)
+    {
+        for(value_t x : a)
+            if(test(b, x))
+                sink.value(x);
+    }
+
+    template<typename Sink>
+    void intersect_array_runs(const values_t& a, const values_t& runs, Sink& sink)
+    {
+        std::size_t k = 0;
+
+        for(value_t x : a)
+        {
+            while(k < runs.size() && runs[k + 1] < x)
+                k += 2;
+
+            if(k == runs.size())
+                return;
+            if(runs[k] <= x)
+                sink.value(x);
+        }
+    }
+
+    template<typename Sink>
+    void intersect_bitsets(bit_row a, bit_row b, Sink& sink)
+    {
+        for(std::size_t w = 0; w < std::min(a.words, b.words); ++w)
+            sink.word(w, a.data[w] & b.data[w]);
+    }
+
+    template<typename Sink>
+    void intersect_bitset_runs(bit_row a, const values_t& runs, Sink& sink)
+    {
+        const std::size_t bits = a.words * bits_per_word;
+
+        for(std::size_t k = 0; k < runs.size() && runs[k] < bits; k += 2)
+        {
+            std::size_t first = runs[k], last = std::min<std::size_t>(runs[k + 1], bits - 1);
+
+            for(std::size_t w = first / bits_per_word; w <= last / bits_per_word; ++w)
+                sink.word(w, a.data[w] & bits_between(std::max(first, w * bits_per_word),
+                                                      std::min(last, w * bits_per_word + bits_per_word - 1)));
+        }
+    }
+
+    template<typename Sink>
+    void intersect_runs(const values_t& a, const values_t& b, Sink& sink)
+    {
+        for(std::size_t i = 0, j = 0; i < a.size() && j < b.size(); )
+        {
+            std::size_t first = std::max(a[i], b[j]), last = std::min(a[i + 1], b[j + 1]);
+
+            if(first <= last)
+                sink.range(first, last);
+
+            if(a[i + 1] < b[j + 1])
+                i += 2;
+            else
+                j += 2;
+        }
+    }
+
+    template<typename Sink>
+    void unite_arrays(const values_t& a, const values_t& b, Sink& sink)
+    {
+        auto i = a.begin(), j = b.begin();
+
+        while(i != a.end() || j != b.end())
+        {
+            if(j == b.end() || (i != a.end() && *i < *j))
+                sink.value(*i++);
+            else if(i == a.end() || *j < *i)
+                sink.value(*j++);
+            else
+            {
+                sink.value(*i++);
+                ++j;
+            }
+        }
+    }
+
+    template<typename Sink>
+    void unite_array_bitset(const values_t& a, bit_row b, Sink& sink)
+    {
+        auto i = a.begin();
+
+        for(std::size_t w = 0; w < b.words; ++w)
+        {
+            bit_word word = b.data[w];
+
+            for(; i != a.end() && *i / bits_per_word == w; ++i)
+                word |= bit_mask(*i);
+
+            sink.word(w, word);
+        }
+
+        for(; i != a.end(); ++i)
+            sink.value(*i);
+    }
+
+    template<typename Sink>
+    void unite_array_runs(const values_t& a, const values_t& runs, Sink& sink)
+    {
+        auto i = a.begin();
+
+        for(std::size_t k = 0; k < runs.size(); k += 2)
+        {
+            for(; i != a.end() && *i < runs[k]; ++i)
+                sink.value(*i);
+
+            sink.range(runs[k], runs[k + 1]);
+
+            for(; i != a.end() && *i <= runs[k + 1]; ++i)
+            {}
+        }
+
+        for(; i != a.end(); ++i)
+            sink.value(*i);
+    }
+
+    template<typename Sink>
+    void unite_bitsets(bit_row a, bit_row b, Sink& sink)
+    {
+        for(std::size_t w = 0; w < std::max(a.words, b.words); ++w)
+            sink.word(w, (w < a.words ? a.data[w] : 0) | (w < b.words ? b.data[w] : 0));
+    }
+
+    template<typename Sink>
+    void unite_bitset_runs(bit_row a, const values_t& runs, Sink& sink)
+    {
+        const std::size_t bits = a.words * bits_per_word;
+        std::size_t k = 0;
+
+        for(std::size_t w = 0; w < a.words; ++w)
+        {
+            const std::size_t begin = w * bits_per_word, last_bit = begin + bits_per_word - 1;
+            bit_word word = a.data[w];
+
+            for(; k < runs.size() && runs[k] <= last_bit; k += 2)
+            {
+                word |= bits_between(std::max<std::size_t>(runs[k], begin), std::min<std::size_t>(runs[k + 1], last_bit));
+
+                if(runs[k + 1] > last_bit)
+                    break;
+            }
+
+            sink.word(w, word);
+        }
+
+        // Whatever the runs hold past the bitset
+        for(; k < runs.size(); k += 2)
+            sink.range(std::max<std::size_t>(runs[k], bits), runs[k + 1]);
+    }
+
+    template<typename Sink>
+    void unite_runs(const values_t& a, const values_t& b, Sink& sink)
+    {
+        std::size_t i = 0, j = 0;
+        bool open = false;
+        std::size_t first = 0, last = 0;
+
+        while(i < a.size() || j < b.size())
+        {
+            const values_t& next = j == b.size() || (i < a.size() && a[i] < b[j]) ? a : b;
+            std::size_t& k = &next == &a ? i : j;
+
+            // Overlapping or adjacent runs are coalesced
+            if(open && next[k] <= last + 1)
+                last = std::max<std::size_t>(last, next[k + 1]);
+            else
+            {
+                if(open)
+                    sink.range(first, last);
+
+                first = next[k];
+                last = next[k + 1];
+                open = true;
+            }
+
+            k += 2;
+        }
+
+        if(open)
+            sink.range(first, last);
+    }
+
+    // One kernel per pair of layouts; both operations are symmetric, so the pair is put
+    // in array, bitset, run order first
+    template<typename Sink>
+    void intersect(const hybrid_row& a, const hybrid_row& b, Sink& sink)
+    {
+        if(a.kind() > b.kind())
+            return intersect(b, a, sink);
+
+        switch(a.kind())
+        {
+        case row_container::array:
+            switch(b.kind())
+            {
+            case row_container::array:
+                return intersect_arrays(a.values(), b.values(), sink);
+            case row_container::bitset:
+                return intersect_array_bitset(a.values(), b.bits(), sink);
+            case row_container::run:
+                return intersect_array_runs(a.values(), b.values(), sink);
+            }
+            break;
+        case row_container::bitset:
+            if(b.kind() == row_container::bitset)
+                return intersect_bitsets(a.bits(), b.bits(), sink);
+
+            return intersect_bitset_runs(a.bits(), b.values(), sink);
+        case row_container::run:
+            return intersect_runs(a.values(), b.values(), sink);
+        }
+    }
+
+    template<typename Sink>
+    void unite(const hybrid_row& a, const hybrid_row& b, Sink& sink)
+    {
+        if(a.kind() > b.kind())
+            return unite(b, a, sink);
+
+        switch(a.kind())
+        {
+        case row_container::array:
+            switch(b.kind())
+            {
+            case row_container::array:
+                return unite_arrays(a.values(), b.values(), sink);
+            case row_container::bitset:
+                return unite_array_bitset(a.values(), b.bits(), sink);
+            case row_container::run:
+                return unite_array_runs(a.values(), b.values(), sink);
+            }
+            break;
+        case row_container::bitset:
+            if(b.kind() == row_container::bitset)
+                return unite_bitsets(a.bits(), b.bits(), sink);
+
+            return unite_bitset_runs(a.bits(), b.values(), sink);
+        case row_container::run:
+            return unite_runs(a.values(), b.values(), sink);
+        }
+    }
+}
+
+// Adjacency for graphs that mix hubs with degree near n and millions of low degree
+// nodes: every row is a hybrid_row that moves to the smallest of its three layouts as
+// edges are written, so sparse rows cost four bytes per arc, hub rows one bit per node
+// and rows of consecutive ids eight bytes per run.
+struct hybrid_storage {
+private:
+    struct node_proxy;
+
+public:
+    using edge_t = std::pair<std::size_t, std::size_t>;
+
+    struct edge_iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = edge_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const edge_t*;
+        using reference = edge_t;
+
+        edge_iterator() = default;
+
+        edge_iterator(const hybrid_storage* storage, std::size_t row) :
+            _storage{storage},
+            _row{row}
+        {
+            if(_row < _storage->nodes_count())
+                _it = _storage->_rows[_row].begin();
+
+            _settle();
+        }
+
+        edge_t operator*() const
+        {
+            return std::make_pair(_row, *_it);
+        }
+
+        edge_iterator& operator++()
+        {
+            ++_it;
+            _settle();
+            return *this;
+        }
+
+        edge_iterator operator++(int)
+        {
+            edge_iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        friend bool operator==(const edge_iterator& lhs, const edge_iterator& rhs)
+        {
+            return lhs._row == rhs._row && lhs._it == rhs._it;
+        }
+
+        friend bool operator!=(const edge_iterator& lhs, const edge_iterator& rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        void _settle()
+        {
+            while(_row < _storage->nodes_count())
+            {
+                if(_it == _storage->_rows[_row].end())
+                {
+                    if(++_row < _storage->nodes_count())
+                        _it = _storage->_rows[_row].begin();
+                    else
+                        _it = {};
+                }
+                else if(_storage->directed() || *_it >= _row)
+                    return;
+                else
+                    ++_it;
+            }
+        }
+
+        const hybrid_storage* _storage = nullptr;
+        std::size_t _row = 0;
+        hybrid_row::iterator _it;
+    };
+
+    hybrid_storage(bool directed = false) : _directed{ directed }
+    {}
+
+    hybrid_storage(std::size_t nodes_count, bool directed = false) :
+        _rows(nodes_count),
+        _directed{directed}
+    {}
+
+    hybrid_storage(std::initializer_list<std::initializer_list<int>> pairs, std::size_t nodes_count, bool directed = false) :
+        hybrid_storage{nodes_count, directed}
+    {
+        add_edges(pairs);
+    }
+
+    bool directed() const noexcept
+    {
+        return _directed;
+    }
+
+    std::size_t nodes_count() const noexcept
+    {
+        return _rows.size();
+    }
+
+    std::size_t arcs_count() const noexcept
+    {
+        return _arcs_count;
+    }
+
+    const hybrid_row& row(std::size_t node) const
+    {
+        assert(node < nodes_count());
+        return _rows[node];
+    }
+
+    row_container row_kind(std::size_t node) const
+    {
+        return row(node).kind();
+    }
+
+    // Bytes of the row containers, headers included
+    std::size_t bytes() const
+    {
+        std::size_t result = _rows.size() * sizeof(hybrid_row);
+
+        for(const auto& row : _rows)
+            result += row.bytes();
+
+        return result;
+    }
+
+    void clear()
+    {
+        for(auto& row : _rows)
+            row = hybrid_row{};
+
+        _arcs_count = 0;
+    }
+
+    std::size_t degree(std::size_t node) const
+    {
+        return row(node).cardinality();
+    }
+
+    auto neighbors(std::size_t node) const
+    {
+        return ranges::make_iterator_range(row(node).begin(), row(node).end());
+    }
+
+    auto edges() const
+    {
+        return ranges::make_iterator_range(edge_iterator{this, 0}, edge_iterator{this, nodes_count()});
+    }
+
+    std::size_t count_common_neighbors(std::size_t i, std::size_t j) const
+    {
+        hybrid_detail::count_sink sink;
+        hybrid_detail::intersect(row(i), row(j), sink);
+        return sink.count;
+    }
+
+    std::vector<std::size_t> common_neighbors(std::size_t i, std::size_t j) const
+    {
+        std::vector<std::size_t> result;
+        hybrid_detail::vector_sink sink{result};
+        hybrid_detail::intersect(row(i), row(j), sink);
+        return result;
+    }
+
+    std::size_t count_union_neighbors(std::size_t i, std::size_t j) const
+    {
+        hybrid_detail::count_sink sink;
+        hybrid_detail::unite(row(i), row(j), sink);
+        return sink.count;
+    }
+
+    std::vector<std::size_t> union_neighbors(std::size_t i, std::size_t j) const
+    {
+        std::vector<std::size_t> result;
+        hybrid_detail::vector_sink sink{result};
+        hybrid_detail::unite(row(i), row(j), sink);
+        return result;
+    }
+
+    void add_edges(std::initializer_list<std::initializer_list<int>> pairs) {
+        _apply_edges(pairs, true);
+    }
+
+    void add_edges(const std::vector<edge_t>& edges) {
+        add_edges(edges.begin(), edges.end());
+    }
+
+    template<typename Iterator>
+    void add_edges(Iterator first, Iterator last) {
+        for(; first != last; ++first)
+            _set((*first).first, (*first).second, true);
+    }
+
+    void remove_edges(std::initializer_list<std::initializer_list<int>> pairs) {
+        _apply_edges(pairs, false);
+    }
+
+    void remove_edges(const std::vector<edge_t>& edges) {
+        remove_edges(edges.begin(), edges.end());
+    }
+
+    template<typename Iterator>
+    void remove_edges(Iterator first, Iterator last) {
+        for(; first != last; ++first)
+            _set((*first).first, (*first).second, false);
+    }
+
+    void edges(std::initializer_list<std::initializer_list<int>> pairs) {
+        clear();
+        add_edges(pairs);
+    }
+
+    bool operator()(std::size_t i, std::size_t j) const noexcept {
+        assert(i < nodes_count() && j < nodes_count());
+        return _rows[i].test(j);
+    }
+
+    node_proxy operator()(std::size_t i, std::size_t j) noexcept {
+        assert(i < nodes_count() && j < nodes_count());
+        return {this, i, j};
+    }
+
+    bool at(std::size_t i, std::size_t j) const {
+        if (i < nodes_count() && j < nodes_count())
+            return (*this)(i, j);
+        else
+            throw std::out_of_range{"hybrid_storage::at(i,j): Index out of range"};
+    }
+
+    node_proxy at(std::size_t i, std::size_t j) {
+        if (i < nodes_count() && j < nodes_count())
+            return (*this)(i, j);
+        else
+            throw std::out_of_range{"hybrid_storage::at(i,j): Index out of range"};
+    }
+
+    void reserve(std::size_t nodes_count)
+    {
+        _rows.reserve(nodes_count);
+    }
+
+    // New rows are empty arrays, no bitset grows with the node count
+    void add_node()
+    {
+        _rows.emplace_back();
+    }
+
+    void add_nodes(std::size_t count)
+    {
+        _rows.resize(_rows.size() + count);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const hybrid_storage& m)
+    {
+        for(std::size_t i = 0; i < m.nodes_count(); ++i)
+        {
+            os << "node " << i << ": ";
+
+            for(auto j : m.neighbors(i))
+                os << j << " ";
+
+            os << "\n";
+        }
+
+        return os;
+    }
+
+private:
+    void _apply_edges(std::initializer_list<std::initializer_list<int>> pairs, bool value)
+    {
+        for(auto pair : pairs)
+        {
+            assert(std::end(pair) - std::begin(pair) == 2);
+
+            int a = *(std::begin(pair));
+            int b = *(std::begin(pair) + 1);
+
+            (*this)(a,b) = value;
+        }
+    }
+
+    void _set(std::size_t i, std::size_t j, bool value)
+    {
+        assert(i < nodes_count() && j < nodes_count());
+        _write(i, j, value);
+
+        if(!directed() && i != j)
+            _write(j, i, value);
+    }
+
+    void _write(std::size_t i, std::size_t j, bool value)
+    {
+        hybrid_row& row = _rows[i];
+
+        if(value ? row.set(j) : row.reset(j))
+        {
+            _arcs_count = value ? _arcs_count + 1 : _arcs_count - 1;
+            row.adapt();
+        }
+    }
+
+    struct node_proxy
+    {
+        node_proxy(hybrid_storage* storage, std::size_t _i, std::size_t _j) :
+            _ref{storage},
+            i{_i},
+            j{_j}
+        {}
+
+        bool operator=(bool b)
+        {
+            _ref->_set(i, j, b);
+            return b;
+        }
+
+        operator bool() const
+        {
+            return _ref->_rows[i].test(j);
+        }
+
+        hybrid_storage* _ref;
+        std::size_t i, j;
+    };
+
+    std::vector<hybrid_row> _rows;
+    std::size_t _arcs_count = 0;
+    bool _directed = false;
+};
+
+#endif //PRACTICA2MAR_HYBRID_STORAGE_HPP
@@ -0,0 +1,193 @@
+#ifndef PRACTICA2MAR_INSTRUMENTATION_HPP
+#define PRACTICA2MAR_INSTRUMENTATION_HPP
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "aligned_allocator.hpp"
+
+// Storage operations an observer policy is told about
+enum class graph_event
+{
+    edge_write,
+    node_add,
+    neighbor_scan,
+    relayout
+};
+
+constexpr std::size_t graph_events_count = 4;
+
+inline const char* event_name(graph_event event)
+{
+    static const char* names[graph_events_count] = {"edge_write", "node_add", "neighbor_scan", "relayout"};
+    return names[static_cast<std::size_t>(event)];
+}
+
+// Default observer policy: every hook is an empty inline function and every timer an
+// empty object, so instrumented storages compile to the same code as before
+struct null_observer
+{
+    static constexpr bool enabled = false;
+
+    static void count(graph_event, std::uint64_t = 1)
+    {}
+
+    struct timer
+    {
+        explicit timer(graph_event)
+        {}
+    };
+};
+
+struct observer_snapshot
+{
+    std::array<std::uint64_t, graph_events_count> counts{};
+    std::array<std::uint64_t, graph_events_count> nanoseconds{};
+
+    std::uint64_t count(graph_event event) const
+    {
+        return counts[static_cast<std::size_t>(event)];
+    }
+
+    std::chrono::nanoseconds time(graph_event event) const
+    {
+        return std::chrono::nanoseconds{nanoseconds[static_cast<std::size_t>(event)]};
+    }
+
+    void write_json(std::ostream& os) const
+    {
+        os << "{";
+
+        for(std::size_t e = 0; e < graph_events_count; ++e)
+        {
+            os << (e ? ", " : "") << "\"" << event_name(static_cast<graph_event>(e)) << "\": {\"count\": "
+               << counts[e] << ", \"ns\": " << nanoseconds[e] << "}";
+        }
+
+        os << "}";
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const observer_snapshot& s)
+    {
+        for(std::size_t e = 0; e < graph_events_count; ++e)
+            os << event_name(static_cast<graph_event>(e)) << ": " << s.counts[e] << " (" << s.nanoseconds[e] << "ns)\n";
+
+        return os;
+    }
+};
+
+// Counts every event and times the ones a storage wraps in a timer. Each thread owns a
+// slot only it writes to (relaxed atomics, no contended cache lines); snapshot() adds up
+// the slots of every thread that ever reported, including finished ones. Tag keeps
+// separate registries for storages that should be reported apart.
+template<typename Tag = void>
+struct counting_observer
+{
+    static constexpr bool enabled = true;
+
+    static void count(graph_event event, std::uint64_t n = 1)
+    {
+        _add(_local().counts[static_cast<std::size_t>(event)], n);
+    }
+
+    struct timer
+    {
+        explicit timer(graph_event event) :
+            _event{event},
+            _begin{std::chrono::steady_clock::now()}
+        {}
+
+        timer(const timer&) = delete;
+        timer& operator=(const timer&) = delete;
+
+        ~timer()
+        {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _begin);
+            _add(_local().nanoseconds[static_cast<std::size_t>(_event)], static_cast<std::uint64_t>(elapsed.count()));
+        }
+
+    private:
+        graph_event _event;
+        std::chrono::steady_clock::time_point _begin;
+    };
+
+    static observer_snapshot snapshot()
+    {
+        observer_snapshot result;
+        std::lock_guard<std::mutex> lock{_registry().mutex};
+
+        for(const auto& slot : _registry().slots)
+        {
+            for(std::size_t e = 0; e < graph_events_count; ++e)
+            {
+                result.counts[e] += slot->counts[e].load(std::memory_order_relaxed);
+                result.nanoseconds[e] += slot->nanoseconds[e].load(std::memory_order_relaxed);
+            }
+        }
+
+        return result;
+    }
+
+    // Not synchronized with threads reporting at the same time
+    static void reset()
+    {
+        std::lock_guard<std::mutex> lock{_registry().mutex};
+
+        for(const auto& slot : _registry().slots)
+        {
+            for(std::size_t e = 0; e < graph_events_count; ++e)
+            {
+                slot->counts[e].store(0, std::memory_order_relaxed);
+                slot->nanoseconds[e].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct alignas(64) slot
+    {
+        std::array<std::atomic<std::uint64_t>, graph_events_count> counts{};
+        std::array<std::atomic<std::uint64_t>, graph_events_count> nanoseconds{};
+    };
+
+    struct registry
+    {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<slot>> slots;
+    };
+
+    static registry& _registry()
+    {
+        static registry instance;
+        return instance;
+    }
+
+    static slot& _local()
+    {
+        static thread_local std::shared_ptr<slot> local = []
+        {
+            // make_shared ignores the slot's over-alignment before C++17
+            auto result = std::allocate_shared<slot>(aligned_allocator<slot>{});
+            assert(reinterpret_cast<std::uintptr_t>(result.get()) % alignof(slot) == 0);
+            std::lock_guard<std::mutex> lock{_registry().mutex};
+            _registry().slots.push_back(result);
+            return result;
+        }();
+
+        return *local;
+    }
+
+    static void _add(std::atomic<std::uint64_t>& counter, std::uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+#endif //PRACTICA2MAR_INSTRUMENTATION_HPP
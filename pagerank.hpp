@@ -0,0 +1,302 @@
+#ifndef PRACTICA2MAR_PAGERANK_HPP
+#define PRACTICA2MAR_PAGERANK_HPP
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "graph.hpp"
+#include "thread_pool.hpp"
+
+template<typename Real = double>
+struct pagerank_options
+{
+    Real damping = Real(0.85);
+    // L1 distance between two consecutive rank vectors that stops the iteration
+    Real tolerance = Real(1e-6);
+    std::size_t max_iterations = 100;
+};
+
+template<typename Real>
+struct pagerank_result
+{
+    std::vector<Real> rank;
+    std::size_t iterations = 0;
+    Real error = Real(0);
+};
+
+namespace pagerank_detail
+{
+    // Arcs grouped by target, the layout pull iterations read
+    struct pull_csr
+    {
+        std::vector<std::size_t> offsets;
+        std::vector<std::size_t> sources;
+        std::vector<std::size_t> out_degree;
+    };
+
+    template<typename Storage>
+    auto pull_rows_available(const Storage& storage, int) -> decltype(storage.tracks_in_edges())
+    {
+        return storage.tracks_in_edges();
+    }
+
+    template<typename Storage>
+    bool pull_rows_available(const Storage& storage, long)
+    {
+        return !storage.directed();
+    }
+
+    template<typename Storage>
+    auto pull_row(const Storage& storage, std::size_t v, int) -> decltype(storage.in_neighbors(v))
+    {
+        return storage.in_neighbors(v);
+    }
+
+    template<typename Storage>
+    auto pull_row(const Storage& storage, std::size_t v, long) -> decltype(storage.neighbors(v))
+    {
+        return storage.neighbors(v);
+    }
+
+    template<typename Storage>
+    auto pull_degree(const Storage& storage, std::size_t v, int) -> decltype(storage.in_degree(v))
+    {
+        return storage.in_degree(v);
+    }
+
+    template<typename Storage>
+    std::size_t pull_degree(const Storage& storage, std::size_t v, long)
+    {
+        return storage.degree(v);
+    }
+
+    template<typename Storage>
+    pull_csr transpose(const Storage& storage, thread_pool& pool, std::size_t grain)
+    {
+        const std::size_t n = storage.nodes_count();
+        pull_csr result;
+        result.offsets.assign(n + 1, 0);
+        result.out_degree.resize(n);
+
+        pool.parallel_for(0, n, grain, [&](std::size_t, std::size_t b, std::size_t e)
+        {
+            for(std::size_t u = b; u < e; ++u)
+                result.out_degree[u] = storage.degree(u);
+        });
+
+        if(pull_rows_available(storage, 0))
+        {
+            // In-edges are readable per target, every row fills its own slice
+            pool.parallel_for(0, n, grain, [&](std::size_t, std::size_t b, std::size_t e)
+            {
+                for(std::size_t v = b; v < e; ++v)
+                    result.offsets[v + 1] = pull_degree(storage, v, 0);
+            });
+
+            std::partial_sum(result.offsets.begin(), result.offsets.end(), result.offsets.begin());
+            result.sources.resize(result.offsets.back());
+
+            pool.parallel_for(0, n, grain, [&](std::size_t, std::size_t b, std::size_t e)
+            {
+                for(std::size_t v = b; v < e; ++v)
+                {
+                    std::size_t k = result.offsets[v];
+
+                    for(std::size_t u : pull_row(storage, v, 0))
+                        result.sources[k++] = u;
+                }
+            });
+        }
+        else
+        {
+            for(std::size_t u = 0; u < n; ++u)
+                for(std::size_t v : storage.neighbors(u))
+                    ++result.offsets[v + 1];
+
+            std::partial_sum(result.offsets.begin(), result.offsets.end(), result.offsets.begin());
+            result.sources.resize(result.offsets.back());
+            std::vector<std::size_t> cursor(result.offsets.begin(), result.offsets.end() - 1);
+
+            for(std::size_t u = 0; u < n; ++u)
+                for(std::size_t v : storage.neighbors(u))
+                    result.sources[cursor[v]++] = u;
+        }
+
+        return result;
+    }
+
+    // Row ranges of about the same number of arcs (plus one per row, for the row overhead)
+    inline std::vector<std::size_t> balanced_partition(const std::vector<std::size_t>& offsets, std::size_t parts)
+    {
+        const std::size_t n = offsets.size() - 1;
+        const std::size_t work = offsets.back() + n;
+        std::vector<std::size_t> bounds{0};
+
+        for(std::size_t p = 1; p < parts; ++p)
+        {
+            std::size_t target = work * p / parts;
+
+            // First row whose work prefix reaches the target
+            std::size_t lo = bounds.back(), hi = n;
+            while(lo < hi)
+            {
+                std::size_t mid = lo + (hi - lo) / 2;
+
+                if(offsets[mid] + mid < target)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+
+            bounds.push_back(lo);
+        }
+
+        bounds.push_back(n);
+        return bounds;
+    }
+
+    // Gathered sum with independent accumulators, so the adds pipeline (and vectorize
+    // where the target has gathers) instead of forming one dependency chain
+    template<typename Real>
+    Real gather_sum(const Real* values, const std::size_t* index, std::size_t count)
+    {
+        Real s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        std::size_t k = 0;
+
+        for(; k + 4 <= count; k += 4)
+        {
+            s0 += values[index[k]];
+            s1 += values[index[k + 1]];
+            s2 += values[index[k + 2]];
+            s3 += values[index[k + 3]];
+        }
+
+        for(; k < count; ++k)
+            s0 += values[index[k]];
+
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    // Power iteration of r' = d (A^T D^-1 r + dangling mass * teleport) + (1 - d) teleport
+    template<typename Real>
+    pagerank_result<Real> iterate(const pull_csr& csr, const std::vector<Real>& teleport, const pagerank_options<Real>& options,
+                                  thread_pool& pool)
+    {
+        const std::size_t n = csr.out_degree.size();
+        const std::vector<std::size_t> bounds = balanced_partition(csr.offsets, pool.size() * 8);
+
+        pagerank_result<Real> result;
+        result.rank = teleport;
+        std::vector<Real> next(n), contribution(n);
+        std::vector<Real> dangling(pool.size()), error(pool.size());
+
+        auto for_parts = [&](auto f)
+        {
+            pool.parallel_for(0, bounds.size() - 1, 1, [&](std::size_t worker, std::size_t b, std::size_t e)
+            {
+                for(std::size_t p = b; p < e; ++p)
+                    f(worker, bounds[p], bounds[p + 1]);
+            });
+        };
+
+        for(result.iterations = 0; result.iterations < options.max_iterations; )
+        {
+            std::fill(dangling.begin(), dangling.end(), Real(0));
+            std::fill(error.begin(), error.end(), Real(0));
+
+            for_parts([&](std::size_t worker, std::size_t b, std::size_t e)
+            {
+                for(std::size_t u = b; u < e; ++u)
+                {
+                    if(csr.out_degree[u] == 0)
+                    {
+                        contribution[u] = Real(0);
+                        dangling[worker] += result.rank[u];
+                    }
+                    else
+                        contribution[u] = result.rank[u] / static_cast<Real>(csr.out_degree[u]);
+                }
+            });
+
+            const Real lost = options.damping * std::accumulate(dangling.begin(), dangling.end(), Real(0));
+            const Real jump = Real(1) - options.damping + lost;
+
+            for_parts([&](std::size_t worker, std::size_t b, std::size_t e)
+            {
+                for(std::size_t v = b; v < e; ++v)
+                {
+                    const std::size_t begin = csr.offsets[v];
+                    Real pulled = gather_sum(contribution.data(), csr.sources.data() + begin, csr.offsets[v + 1] - begin);
+
+                    next[v] = options.damping * pulled + jump * teleport[v];
+                    error[worker] += std::abs(next[v] - result.rank[v]);
+                }
+            });
+
+            result.rank.swap(next);
+            ++result.iterations;
+            result.error = std::accumulate(error.begin(), error.end(), Real(0));
+
+            if(result.error < options.tolerance)
+                break;
+        }
+
+        return result;
+    }
+}
+
+// Pull based PageRank. Real picks the precision of the rank vectors; float halves the
+// memory traffic of every iteration. Removed ids of a matrix that has not been compacted
+// are ranked as dangling nodes and take their share of the teleport mass.
+template<typename Real = double, typename Storage>
+pagerank_result<Real> pagerank(const Storage& storage, const pagerank_options<Real>& options = {},
+                               thread_pool& pool = thread_pool::default_pool(), std::size_t grain = 256)
+{
+    const std::size_t n = storage.nodes_count();
+
+    if(n == 0)
+        return {};
+
+    std::vector<Real> teleport(n, Real(1) / static_cast<Real>(n));
+    return pagerank_detail::iterate(pagerank_detail::transpose(storage, pool, grain), teleport, options, pool);
+}
+
+// Random jumps (and the rank of dangling nodes) only go back to the given sources
+template<typename Real = double, typename Storage>
+pagerank_result<Real> personalized_pagerank(const Storage& storage, const std::vector<std::size_t>& sources,
+                                            const pagerank_options<Real>& options = {},
+                                            thread_pool& pool = thread_pool::default_pool(), std::size_t grain = 256)
+{
+    if(sources.empty())
+        throw std::logic_error{"personalized_pagerank(): No source nodes"};
+
+    std::vector<Real> teleport(storage.nodes_count(), Real(0));
+
+    for(std::size_t source : sources)
+    {
+        assert(source < storage.nodes_count());
+        teleport[source] += Real(1) / static_cast<Real>(sources.size());
+    }
+
+    return pagerank_detail::iterate(pagerank_detail::transpose(storage, pool, grain), teleport, options, pool);
+}
+
+template<typename Real = double, typename Node, typename Storage>
+pagerank_result<Real> pagerank(const graph<Node, Storage>& g, const pagerank_options<Real>& options = {},
+                               thread_pool& pool = thread_pool::default_pool(), std::size_t grain = 256)
+{
+    return pagerank<Real>(g.adjacency(), options, pool, grain);
+}
+
+template<typename Real = double, typename Node, typename Storage>
+pagerank_result<Real> personalized_pagerank(const graph<Node, Storage>& g, const std::vector<std::size_t>& sources,
+                                            const pagerank_options<Real>& options = {},
+                                            thread_pool& pool = thread_pool::default_pool(), std::size_t grain = 256)
+{
+    return personalized_pagerank<Real>(g.adjacency(), sources, options, pool, grain);
+}
+
+#endif //PRACTICA2MAR_PAGERANK_HPP
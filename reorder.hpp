@@ -0,0 +1,277 @@
+#ifndef PRACTICA2MAR_REORDER_HPP
+#define PRACTICA2MAR_REORDER_HPP
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include "graph.hpp"
+
+enum class reorder_strategy
+{
+    reverse_cuthill_mckee,
+    degree_descending,
+    gorder
+};
+
+namespace reorder_detail
+{
+    inline std::vector<std::size_t> invert(const std::vector<std::size_t>& order)
+    {
+        std::vector<std::size_t> old_to_new(order.size());
+
+        for(std::size_t k = 0; k < order.size(); ++k)
+            old_to_new[order[k]] = k;
+
+        return old_to_new;
+    }
+
+    template<typename Storage>
+    std::vector<std::size_t> degrees(const Storage& storage)
+    {
+        std::vector<std::size_t> result(storage.nodes_count());
+
+        for(std::size_t i = 0; i < result.size(); ++i)
+            result[i] = storage.degree(i);
+
+        return result;
+    }
+
+    template<typename Storage>
+    std::vector<std::size_t> degree_descending(const Storage& storage)
+    {
+        std::vector<std::size_t> degree = degrees(storage);
+        std::vector<std::size_t> order(degree.size());
+        std::iota(order.begin(), order.end(), std::size_t{0});
+
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs)
+        {
+            return degree[lhs] > degree[rhs];
+        });
+
+        return order;
+    }
+
+    // Each component is traversed breadth-first from its lowest degree node, visiting
+    // neighbors by increasing degree; the whole sequence is then reversed
+    template<typename Storage>
+    std::vector<std::size_t> reverse_cuthill_mckee(const Storage& storage)
+    {
+        const std::size_t n = storage.nodes_count();
+        std::vector<std::size_t> degree = degrees(storage);
+        std::vector<std::size_t> by_degree(n), order, neighbors;
+        std::vector<bool> visited(n, false);
+        order.reserve(n);
+
+        std::iota(by_degree.begin(), by_degree.end(), std::size_t{0});
+        std::stable_sort(by_degree.begin(), by_degree.end(), [&](std::size_t lhs, std::size_t rhs)
+        {
+            return degree[lhs] < degree[rhs];
+        });
+
+        for(std::size_t root : by_degree)
+        {
+            if(visited[root])
+                continue;
+
+            visited[root] = true;
+            order.push_back(root);
+
+            for(std::size_t head = order.size() - 1; head < order.size(); ++head)
+            {
+                neighbors.clear();
+
+                for(std::size_t v : storage.neighbors(order[head]))
+                {
+                    if(!visited[v])
+                    {
+                        visited[v] = true;
+                        neighbors.push_back(v);
+                    }
+                }
+
+                std::stable_sort(neighbors.begin(), neighbors.end(), [&](std::size_t lhs, std::size_t rhs)
+                {
+                    return degree[lhs] < degree[rhs];
+                });
+
+                order.insert(order.end(), neighbors.begin(), neighbors.end());
+            }
+        }
+
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
+
+    // Greedy Gorder (Wei et al.): the next node is the one sharing the most neighbors
+    // with, or being adjacent to, the last window nodes placed. Scores live in lazy
+    // buckets, stale entries are skipped when popped.
+    template<typename Storage>
+    std::vector<std::size_t> gorder(const Storage& storage, std::size_t window)
+    {
+        const std::size_t n = storage.nodes_count();
+        std::vector<std::size_t> score(n, 0), order;
+        std::vector<bool> placed(n, false);
+        std::vector<std::vector<std::size_t>> buckets(1);
+        std::size_t top = 0;
+        order.reserve(n);
+
+        // Bucket 0 pops highest degree first
+        std::vector<std::size_t> seeds = degree_descending(storage);
+        buckets[0].assign(seeds.rbegin(), seeds.rend());
+
+        auto bump = [&](std::size_t v, bool up)
+        {
+            if(placed[v])
+                return;
+
+            if(up)
+                ++score[v];
+            else
+                --score[v];
+
+            if(score[v] >= buckets.size())
+                buckets.resize(score[v] + 1);
+
+            buckets[score[v]].push_back(v);
+            top = std::max(top, score[v]);
+        };
+
+        auto touch = [&](std::size_t u, bool up)
+        {
+            for(std::size_t v : storage.neighbors(u))
+            {
+                bump(v, up);
+
+                for(std::size_t w : storage.neighbors(v))
+                    if(w != u)
+                        bump(w, up);
+            }
+        };
+
+        while(order.size() < n)
+        {
+            std::size_t next = n;
+
+            while(next == n)
+            {
+                auto& bucket = buckets[top];
+
+                if(bucket.empty())
+                {
+                    --top;
+                    continue;
+                }
+
+                std::size_t v = bucket.back();
+                bucket.pop_back();
+
+                if(!placed[v] && score[v] == top)
+                    next = v;
+            }
+
+            placed[next] = true;
+            order.push_back(next);
+            touch(next, true);
+
+            if(order.size() > window)
+                touch(order[order.size() - window - 1], false);
+        }
+
+        return order;
+    }
+
+    template<typename S>
+    static auto freeze(S& storage, int) -> decltype(storage.freeze(), void())
+    {
+        storage.freeze();
+    }
+
+    template<typename S>
+    static void freeze(S&, long)
+    {}
+
+    // Tombstones would land on arbitrary ids after the permutation
+    template<typename S>
+    static auto check_compacted(const S& storage, int) -> decltype(storage.removed_count(), void())
+    {
+        if(storage.removed_count() > 0)
+            throw std::logic_error{"reorder(): Storage has removed nodes, compact() it first"};
+    }
+
+    template<typename S>
+    static void check_compacted(const S&, long)
+    {}
+
+    template<typename S>
+    static auto track_in_edges(const S& source, S& result, int) -> decltype(result.track_in_edges(), void())
+    {
+        if(source.directed() && source.tracks_in_edges())
+            result.track_in_edges();
+    }
+
+    template<typename S>
+    static void track_in_edges(const S&, S&, long)
+    {}
+
+    template<typename Storage>
+    Storage permute(const Storage& storage, const std::vector<std::size_t>& old_to_new)
+    {
+        using edge_t = typename Storage::edge_t;
+
+        check_compacted(storage, 0);
+
+        Storage result{storage.directed()};
+        result.add_nodes(storage.nodes_count());
+
+        std::vector<edge_t> edges;
+
+        for(auto edge : storage.edges())
+            edges.emplace_back(old_to_new[edge.first], old_to_new[edge.second]);
+
+        result.add_edges(edges);
+        freeze(result, 0);
+        track_in_edges(storage, result, 0);
+        return result;
+    }
+}
+
+// Old to new id mapping that improves locality of the given storage. window is the
+// Gorder sliding window size, ignored by the other strategies.
+template<typename Storage>
+std::vector<std::size_t> reorder_permutation(const Storage& storage, reorder_strategy strategy = reorder_strategy::reverse_cuthill_mckee,
+                                             std::size_t window = 5)
+{
+    switch(strategy)
+    {
+        case reorder_strategy::degree_descending:
+            return reorder_detail::invert(reorder_detail::degree_descending(storage));
+        case reorder_strategy::gorder:
+            return reorder_detail::invert(reorder_detail::gorder(storage, window));
+        default:
+            return reorder_detail::invert(reorder_detail::reverse_cuthill_mckee(storage));
+    }
+}
+
+// Renumbers the storage in place, returns the old to new id mapping. Tracked in-edges
+// stay tracked; a matrix with removed nodes has to be compacted first.
+template<typename Storage>
+std::vector<std::size_t> reorder(Storage& storage, reorder_strategy strategy = reorder_strategy::reverse_cuthill_mckee,
+                                 std::size_t window = 5)
+{
+    std::vector<std::size_t> old_to_new = reorder_permutation(storage, strategy, window);
+    storage = reorder_detail::permute(storage, old_to_new);
+    return old_to_new;
+}
+
+template<typename Node, typename Storage>
+std::vector<std::size_t> reorder(graph<Node, Storage>& g, reorder_strategy strategy = reorder_strategy::reverse_cuthill_mckee,
+                                 std::size_t window = 5)
+{
+    std::vector<std::size_t> old_to_new = reorder_permutation(g.adjacency(), strategy, window);
+    g.relabel(old_to_new, reorder_detail::permute(g.adjacency(), old_to_new));
+    return old_to_new;
+}
+
+#endif //PRACTICA2MAR_REORDER_HPP
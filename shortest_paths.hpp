@@ -0,0 +1,282 @@
+#ifndef PRACTICA2MAR_SHORTEST_PATHS_HPP
+#define PRACTICA2MAR_SHORTEST_PATHS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+#include "graph.hpp"
+#include "weighted_storage.hpp"
+#include "thread_pool.hpp"
+#include "bit_row.hpp"
+
+template<typename Weight>
+struct shortest_paths_result
+{
+    std::vector<Weight> distance;
+    std::vector<std::size_t> parent;
+
+    bool reached(std::size_t node) const
+    {
+        return distance[node] != no_weight<Weight>();
+    }
+};
+
+namespace shortest_paths_detail
+{
+    // Order preserving map of non-negative weights into unsigned keys; non-negative IEEE
+    // floats already compare like their bit patterns
+    template<typename Weight>
+    std::uint64_t radix_key(Weight weight, std::true_type)
+    {
+        static_assert(sizeof(Weight) <= sizeof(std::uint64_t), "Unsupported weight type");
+        assert(!(weight < Weight{0}));
+
+        typename std::conditional<sizeof(Weight) == 4, std::uint32_t, std::uint64_t>::type bits;
+        std::memcpy(&bits, &weight, sizeof(bits));
+        return bits;
+    }
+
+    template<typename Weight>
+    std::uint64_t radix_key(Weight weight, std::false_type)
+    {
+        assert(!(weight < Weight{0}));
+        return static_cast<std::uint64_t>(weight);
+    }
+
+    template<typename Weight>
+    std::uint64_t radix_key(Weight weight)
+    {
+        return radix_key(weight, std::is_floating_point<Weight>{});
+    }
+}
+
+// Monotone priority queue for Dijkstra: popped keys never decrease, so items only
+// move towards lower buckets and each one is redistributed at most 64 times
+template<typename Value>
+struct radix_heap
+{
+    bool empty() const noexcept
+    {
+        return _size == 0;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return _size;
+    }
+
+    void push(std::uint64_t key, const Value& value)
+    {
+        assert(key >= _last);
+        _buckets[_bucket(key)].emplace_back(key, value);
+        ++_size;
+    }
+
+    std::pair<std::uint64_t, Value> pop()
+    {
+        assert(!empty());
+
+        if(_buckets[0].empty())
+        {
+            std::size_t i = 1;
+            while(_buckets[i].empty())
+                ++i;
+
+            _last = std::min_element(_buckets[i].begin(), _buckets[i].end())->first;
+
+            for(const auto& item : _buckets[i])
+                _buckets[_bucket(item.first)].push_back(item);
+
+            _buckets[i].clear();
+        }
+
+        auto item = _buckets[0].back();
+        _buckets[0].pop_back();
+        --_size;
+        return item;
+    }
+
+private:
+    std::size_t _bucket(std::uint64_t key) const
+    {
+        return word_bit_width(key ^ _last);
+    }
+
+    std::array<std::vector<std::pair<std::uint64_t, Value>>, 65> _buckets;
+    std::uint64_t _last = 0;
+    std::size_t _size = 0;
+};
+
+// Single-source shortest paths over non-negative weights
+template<typename Weight>
+shortest_paths_result<Weight> dijkstra(const weighted_csr<Weight>& storage, std::size_t source)
+{
+    const std::size_t n = storage.nodes_count();
+    assert(source < n && storage.frozen());
+
+    shortest_paths_result<Weight> result;
+    result.distance.assign(n, no_weight<Weight>());
+    result.parent.assign(n, no_node);
+    result.distance[source] = Weight{0};
+    result.parent[source] = source;
+
+    radix_heap<std::size_t> queue;
+    queue.push(shortest_paths_detail::radix_key(Weight{0}), source);
+
+    while(!queue.empty())
+    {
+        auto top = queue.pop();
+        std::size_t u = top.second;
+
+        if(shortest_paths_detail::radix_key(result.distance[u]) != top.first)
+            continue;
+
+        auto targets = storage.neighbors(u);
+        const Weight* weight = storage.weights(u).begin();
+
+        for(auto v = targets.begin(); v != targets.end(); ++v, ++weight)
+        {
+            Weight candidate = result.distance[u] + *weight;
+
+            if(candidate < result.distance[*v])
+            {
+                result.distance[*v] = candidate;
+                result.parent[*v] = u;
+                queue.push(shortest_paths_detail::radix_key(candidate), *v);
+            }
+        }
+    }
+
+    return result;
+}
+
+// Parallel delta-stepping (Meyer and Sanders). Nodes are kept in buckets of width delta;
+// light arcs (weight <= delta) are relaxed until the current bucket settles, heavy arcs
+// once per bucket. Only distances are computed, the parent array is left empty. Buckets
+// are kept sparse, by index, since with small deltas and large weights most of them are
+// never used.
+template<typename Weight>
+shortest_paths_result<Weight> delta_stepping(const weighted_csr<Weight>& storage, std::size_t source, Weight delta,
+                                             thread_pool& pool = thread_pool::default_pool(), std::size_t grain = 64)
+{
+    const std::size_t n = storage.nodes_count();
+    assert(source < n && storage.frozen() && delta > Weight{0});
+
+    std::unique_ptr<std::atomic<Weight>[]> distance{new std::atomic<Weight>[n]};
+    for(std::size_t i = 0; i < n; ++i)
+        distance[i].store(no_weight<Weight>(), std::memory_order_relaxed);
+    distance[source].store(Weight{0}, std::memory_order_relaxed);
+
+    auto bucket_of = [&](Weight d)
+    {
+        return static_cast<std::size_t>(d / delta);
+    };
+
+    std::map<std::size_t, std::vector<std::size_t>> buckets{{0, std::vector<std::size_t>{source}}};
+    std::vector<std::vector<std::size_t>> improved(pool.size());
+    std::vector<std::size_t> stamp(n, std::numeric_limits<std::size_t>::max());
+    std::size_t round = 0;
+
+    auto relax = [&](std::size_t worker, std::size_t u, bool light)
+    {
+        Weight du = distance[u].load(std::memory_order_relaxed);
+        auto targets = storage.neighbors(u);
+        const Weight* weight = storage.weights(u).begin();
+
+        for(auto v = targets.begin(); v != targets.end(); ++v, ++weight)
+        {
+            if((*weight <= delta) != light)
+                continue;
+
+            Weight candidate = du + *weight;
+            Weight current = distance[*v].load(std::memory_order_relaxed);
+
+            while(candidate < current)
+            {
+                if(distance[*v].compare_exchange_weak(current, candidate, std::memory_order_relaxed))
+                {
+                    improved[worker].push_back(*v);
+                    break;
+                }
+            }
+        }
+    };
+
+    auto relax_all = [&](const std::vector<std::size_t>& nodes, bool light)
+    {
+        pool.parallel_for(0, nodes.size(), grain, [&](std::size_t worker, std::size_t b, std::size_t e)
+        {
+            for(std::size_t k = b; k < e; ++k)
+                relax(worker, nodes[k], light);
+        });
+
+        for(auto& nodes_improved : improved)
+        {
+            for(std::size_t v : nodes_improved)
+            {
+                buckets[bucket_of(distance[v].load(std::memory_order_relaxed))].push_back(v);
+            }
+
+            nodes_improved.clear();
+        }
+    };
+
+    while(!buckets.empty())
+    {
+        const std::size_t b = buckets.begin()->first;
+        std::vector<std::size_t> settled;
+
+        for(auto bucket = buckets.find(b); bucket != buckets.end(); bucket = buckets.find(b))
+        {
+            std::vector<std::size_t> frontier = std::move(bucket->second);
+            buckets.erase(bucket);
+            ++round;
+
+            // Drop stale entries (moved to a lower distance) and duplicates
+            frontier.erase(std::remove_if(frontier.begin(), frontier.end(), [&](std::size_t v)
+            {
+                if(bucket_of(distance[v].load(std::memory_order_relaxed)) != b || stamp[v] == round)
+                    return true;
+
+                stamp[v] = round;
+                return false;
+            }), frontier.end());
+
+            settled.insert(settled.end(), frontier.begin(), frontier.end());
+            relax_all(frontier, true);
+        }
+
+        std::sort(settled.begin(), settled.end());
+        settled.erase(std::unique(settled.begin(), settled.end()), settled.end());
+        relax_all(settled, false);
+    }
+
+    shortest_paths_result<Weight> result;
+    result.distance.resize(n);
+
+    for(std::size_t i = 0; i < n; ++i)
+        result.distance[i] = distance[i].load(std::memory_order_relaxed);
+
+    return result;
+}
+
+template<typename Node, typename Weight>
+shortest_paths_result<Weight> dijkstra(const graph<Node, weighted_csr<Weight>>& g, std::size_t source)
+{
+    return dijkstra(g.adjacency(), source);
+}
+
+template<typename Node, typename Weight>
+shortest_paths_result<Weight> delta_stepping(const graph<Node, weighted_csr<Weight>>& g, std::size_t source, Weight delta,
+                                             thread_pool& pool = thread_pool::default_pool(), std::size_t grain = 64)
+{
+    return delta_stepping(g.adjacency(), source, delta, pool, grain);
+}
+
+#endif //PRACTICA2MAR_SHORTEST_PATHS_HPP
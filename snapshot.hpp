@@ -0,0 +1,643 @@
+#ifndef PRACTICA2MAR_SNAPSHOT_HPP
+#define PRACTICA2MAR_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "graph.hpp"
+#include "bit_row.hpp"
+
+// On-disk layout, all integers in native byte order (checked on load):
+//
+//   snapshot_header
+//   adjacency section, 64-byte aligned:
+//     matrix: nodes_count rows of row_pitch 64-bit words
+//     csr:    nodes_count + 1 64-bit offsets followed by arcs_count 64-bit targets
+//   optional payload section, 64-byte aligned: nodes_count trivially copyable Node values
+struct snapshot_header
+{
+    static constexpr std::uint32_t current_version = 1;
+    static constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+    enum : std::uint32_t { matrix_kind = 0, csr_kind = 1 };
+    enum : std::uint32_t { directed_flag = 1, payload_flag = 2 };
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t kind;
+    std::uint32_t flags;
+    std::uint64_t nodes_count;
+    std::uint64_t row_pitch;
+    std::uint64_t arcs_count;
+    std::uint64_t adjacency_offset;
+    std::uint64_t adjacency_bytes;
+    std::uint64_t payload_offset;
+    std::uint64_t payload_stride;
+};
+
+namespace snapshot_detail
+{
+    constexpr char magic[8] = {'P', '2', 'M', 'G', 'R', 'A', 'P', 'H'};
+    constexpr std::uint64_t section_alignment = 64;
+
+    inline std::uint64_t align(std::uint64_t offset)
+    {
+        return (offset + section_alignment - 1) / section_alignment * section_alignment;
+    }
+
+    // Header fields come from disk: every size computed from them is overflow checked
+    inline bool checked_add(std::uint64_t a, std::uint64_t b, std::uint64_t& result)
+    {
+        result = a + b;
+        return result >= a;
+    }
+
+    inline bool checked_mul(std::uint64_t a, std::uint64_t b, std::uint64_t& result)
+    {
+        result = a * b;
+        return a == 0 || result / a == b;
+    }
+
+    struct writer
+    {
+        writer(const std::string& path) :
+            _out{path, std::ios::binary | std::ios::trunc}
+        {
+            if(!_out)
+                throw std::runtime_error{"save_snapshot(): Cannot open " + path};
+        }
+
+        void write(const void* data, std::uint64_t bytes)
+        {
+            _out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            _offset += bytes;
+        }
+
+        void pad_to(std::uint64_t offset)
+        {
+            static const char zeros[section_alignment] = {};
+
+            while(_offset < offset)
+                write(zeros, std::min(offset - _offset, section_alignment));
+        }
+
+        void finish()
+        {
+            _out.flush();
+
+            if(!_out)
+                throw std::runtime_error{"save_snapshot(): Write failed"};
+        }
+
+    private:
+        std::ofstream _out;
+        std::uint64_t _offset = 0;
+    };
+
+    inline snapshot_header make_header(std::uint32_t kind, std::size_t nodes_count, bool directed)
+    {
+        snapshot_header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = snapshot_header::current_version;
+        header.byte_order = snapshot_header::byte_order_mark;
+        header.kind = kind;
+        header.flags = directed ? std::uint32_t{snapshot_header::directed_flag} : std::uint32_t{0};
+        header.nodes_count = nodes_count;
+        header.adjacency_offset = align(sizeof(snapshot_header));
+        return header;
+    }
+
+    inline void write_adjacency(writer& out, snapshot_header& header, const adjacency_matrix& matrix, bool dry_run)
+    {
+        if(matrix.removed_count() > 0)
+            throw std::logic_error{"save_snapshot(): adjacency_matrix has removed nodes, compact() it first"};
+
+        header.row_pitch = matrix.row_pitch();
+        header.adjacency_bytes = header.nodes_count * header.row_pitch * sizeof(bit_word);
+
+        for(std::size_t i = 0; !dry_run && i < matrix.nodes_count(); ++i)
+            out.write(matrix.row(i).data, matrix.row_pitch() * sizeof(bit_word));
+    }
+
+    inline void write_adjacency(writer& out, snapshot_header& header, const csr_storage& csr, bool dry_run)
+    {
+        if(!csr.frozen())
+            throw std::logic_error{"save_snapshot(): csr_storage must be frozen"};
+
+        header.arcs_count = csr.arcs_count();
+        header.adjacency_bytes = (header.nodes_count + 1 + header.arcs_count) * sizeof(std::uint64_t);
+
+        if(dry_run)
+            return;
+
+        for(std::size_t offset : csr.offsets())
+        {
+            std::uint64_t value = offset;
+            out.write(&value, sizeof(value));
+        }
+
+        for(std::size_t target : csr.targets())
+        {
+            std::uint64_t value = target;
+            out.write(&value, sizeof(value));
+        }
+    }
+
+    inline std::uint32_t kind_of(const adjacency_matrix&)
+    {
+        return snapshot_header::matrix_kind;
+    }
+
+    inline std::uint32_t kind_of(const csr_storage&)
+    {
+        return snapshot_header::csr_kind;
+    }
+
+    template<typename Storage, typename WritePayload>
+    void save(const Storage& storage, const std::string& path, std::uint64_t payload_stride, WritePayload write_payload)
+    {
+        writer out{path};
+        snapshot_header header = make_header(kind_of(storage), storage.nodes_count(), storage.directed());
+
+        write_adjacency(out, header, storage, true);
+
+        if(payload_stride != 0)
+        {
+            header.flags |= snapshot_header::payload_flag;
+            header.payload_offset = align(header.adjacency_offset + header.adjacency_bytes);
+            header.payload_stride = payload_stride;
+        }
+
+        out.write(&header, sizeof(header));
+        out.pad_to(header.adjacency_offset);
+        write_adjacency(out, header, storage, false);
+
+        if(payload_stride != 0)
+        {
+            out.pad_to(header.payload_offset);
+            write_payload(out);
+        }
+
+        out.finish();
+    }
+}
+
+inline void save_snapshot(const adjacency_matrix& matrix, const std::string& path)
+{
+    snapshot_detail::save(matrix, path, 0, [](snapshot_detail::writer&){});
+}
+
+inline void save_snapshot(const csr_storage& csr, const std::string& path)
+{
+    snapshot_detail::save(csr, path, 0, [](snapshot_detail::writer&){});
+}
+
+// Node payloads are stored only when Node carries data
+template<typename Node, typename Storage>
+void save_snapshot(const graph<Node, Storage>& g, const std::string& path)
+{
+    static_assert(std::is_trivially_copyable<Node>::value, "Snapshot payloads must be trivially copyable");
+
+    std::uint64_t stride = std::is_empty<Node>::value ? 0 : sizeof(Node);
+
+    snapshot_detail::save(g.adjacency(), path, stride, [&](snapshot_detail::writer& out)
+    {
+        for(std::size_t i = 0; i < g.nodes_count(); ++i)
+        {
+            auto node = g(i);
+            out.write(&static_cast<const Node&>(node), sizeof(Node));
+        }
+    });
+}
+
+struct mapped_file
+{
+    explicit mapped_file(const std::string& path)
+    {
+#if defined(_WIN32)
+        _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if(_file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error{"mapped_file: Cannot open " + path};
+
+        LARGE_INTEGER size;
+        GetFileSizeEx(_file, &size);
+        _size = static_cast<std::size_t>(size.QuadPart);
+
+        if(_size > 0)
+        {
+            _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            _data = _mapping ? static_cast<const unsigned char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+
+            if(_data == nullptr)
+            {
+                _release();
+                throw std::runtime_error{"mapped_file: Cannot map " + path};
+            }
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+
+        if(fd < 0)
+            throw std::runtime_error{"mapped_file: Cannot open " + path};
+
+        struct stat info;
+
+        if(::fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error{"mapped_file: Cannot stat " + path};
+        }
+
+        _size = static_cast<std::size_t>(info.st_size);
+
+        if(_size > 0)
+        {
+            void* data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if(data == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error{"mapped_file: Cannot map " + path};
+            }
+
+            _data = static_cast<const unsigned char*>(data);
+        }
+
+        ::close(fd);
+#endif
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    mapped_file(mapped_file&& other) noexcept
+    {
+        _swap(other);
+    }
+
+    mapped_file& operator=(mapped_file&& other) noexcept
+    {
+        _swap(other);
+        return *this;
+    }
+
+    ~mapped_file()
+    {
+        _release();
+    }
+
+    const unsigned char* data() const noexcept
+    {
+        return _data;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return _size;
+    }
+
+private:
+    void _swap(mapped_file& other) noexcept
+    {
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+#if defined(_WIN32)
+        std::swap(_file, other._file);
+        std::swap(_mapping, other._mapping);
+#endif
+    }
+
+    void _release()
+    {
+#if defined(_WIN32)
+        if(_data)
+            UnmapViewOfFile(_data);
+        if(_mapping)
+            CloseHandle(_mapping);
+        if(_file != INVALID_HANDLE_VALUE)
+            CloseHandle(_file);
+
+        _mapping = nullptr;
+        _file = INVALID_HANDLE_VALUE;
+#else
+        if(_data)
+            ::munmap(const_cast<unsigned char*>(_data), _size);
+#endif
+        _data = nullptr;
+        _size = 0;
+    }
+
+    const unsigned char* _data = nullptr;
+    std::size_t _size = 0;
+#if defined(_WIN32)
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+#endif
+};
+
+// Read-only adjacency_matrix served straight from a mapping
+struct mapped_matrix
+{
+    using edge_t = std::pair<std::size_t, std::size_t>;
+
+    mapped_matrix(const bit_word* words, std::size_t nodes_count, std::size_t row_pitch, bool directed) :
+        _words{words},
+        _nodes_count{nodes_count},
+        _row_pitch{row_pitch},
+        _directed{directed}
+    {}
+
+    bool directed() const noexcept
+    {
+        return _directed;
+    }
+
+    std::size_t nodes_count() const
+    {
+        return _nodes_count;
+    }
+
+    std::size_t row_pitch() const noexcept
+    {
+        return _row_pitch;
+    }
+
+    bit_row row(std::size_t node) const
+    {
+        assert(node < nodes_count());
+        return {_words + node * _row_pitch, _row_pitch};
+    }
+
+    std::size_t degree(std::size_t node) const
+    {
+        return row(node).count();
+    }
+
+    bool operator()(std::size_t i, std::size_t j) const noexcept {
+        assert(i < nodes_count() && j < nodes_count());
+        return row(i).test(j);
+    }
+
+    bool at(std::size_t i, std::size_t j) const {
+        if (i < nodes_count() && j < nodes_count())
+            return (*this)(i, j);
+        else
+            throw std::out_of_range{"mapped_matrix::at(i,j): Index out of range"};
+    }
+
+    auto neighbors(std::size_t node) const
+    {
+        return ranges::make_iterator_range(set_bit_iterator{row(node)}, set_bit_iterator::end(row(node)));
+    }
+
+private:
+    const bit_word* _words;
+    std::size_t _nodes_count;
+    std::size_t _row_pitch;
+    bool _directed;
+};
+
+// Read-only csr_storage served straight from a mapping
+struct mapped_csr
+{
+    using edge_t = std::pair<std::size_t, std::size_t>;
+
+    mapped_csr(const std::uint64_t* offsets, const std::uint64_t* targets, std::size_t nodes_count, bool directed) :
+        _offsets{offsets},
+        _targets{targets},
+        _nodes_count{nodes_count},
+        _directed{directed}
+    {}
+
+    bool directed() const noexcept
+    {
+        return _directed;
+    }
+
+    std::size_t nodes_count() const
+    {
+        return _nodes_count;
+    }
+
+    std::size_t degree(std::size_t node) const
+    {
+        assert(node < nodes_count());
+        return static_cast<std::size_t>(_offsets[node + 1] - _offsets[node]);
+    }
+
+    bool operator()(std::size_t i, std::size_t j) const noexcept {
+        assert(i < nodes_count() && j < nodes_count());
+        return std::binary_search(_targets + _offsets[i], _targets + _offsets[i + 1], std::uint64_t{j});
+    }
+
+    bool at(std::size_t i, std::size_t j) const {
+        if (i < nodes_count() && j < nodes_count())
+            return (*this)(i, j);
+        else
+            throw std::out_of_range{"mapped_csr::at(i,j): Index out of range"};
+    }
+
+    auto neighbors(std::size_t node) const
+    {
+        assert(node < nodes_count());
+        return ranges::make_iterator_range(_targets + _offsets[node], _targets + _offsets[node + 1]);
+    }
+
+private:
+    const std::uint64_t* _offsets;
+    const std::uint64_t* _targets;
+    std::size_t _nodes_count;
+    bool _directed;
+};
+
+// Validated snapshot mapping: the constructor checks the header and scans the adjacency
+// once, so every neighbor the views report is a valid node id. Views returned by
+// matrix(), csr() and payload() point into the mapping and must not outlive the snapshot.
+struct graph_snapshot
+{
+    explicit graph_snapshot(const std::string& path) :
+        _file{path}
+    {
+        if(_file.size() < sizeof(snapshot_header))
+            throw std::runtime_error{"graph_snapshot: " + path + " is too small"};
+
+        std::memcpy(&_header, _file.data(), sizeof(_header));
+
+        if(std::memcmp(_header.magic, snapshot_detail::magic, sizeof(_header.magic)) != 0)
+            throw std::runtime_error{"graph_snapshot: " + path + " is not a graph snapshot"};
+        if(_header.version != snapshot_header::current_version)
+            throw std::runtime_error{"graph_snapshot: Unsupported snapshot version"};
+        if(_header.byte_order != snapshot_header::byte_order_mark)
+            throw std::runtime_error{"graph_snapshot: Snapshot byte order does not match this machine"};
+
+        _check_sections(path);
+
+        if(_header.kind == snapshot_header::csr_kind)
+            _check_csr(path);
+        else
+            _check_matrix_padding(path);
+    }
+
+    const snapshot_header& header() const noexcept
+    {
+        return _header;
+    }
+
+    bool directed() const noexcept
+    {
+        return (_header.flags & snapshot_header::directed_flag) != 0;
+    }
+
+    bool has_payload() const noexcept
+    {
+        return (_header.flags & snapshot_header::payload_flag) != 0;
+    }
+
+    std::size_t nodes_count() const noexcept
+    {
+        return static_cast<std::size_t>(_header.nodes_count);
+    }
+
+    mapped_matrix matrix() const
+    {
+        if(_header.kind != snapshot_header::matrix_kind)
+            throw std::logic_error{"graph_snapshot::matrix(): Snapshot does not hold an adjacency matrix"};
+
+        return {reinterpret_cast<const bit_word*>(_section(_header.adjacency_offset)), nodes_count(),
+                static_cast<std::size_t>(_header.row_pitch), directed()};
+    }
+
+    mapped_csr csr() const
+    {
+        if(_header.kind != snapshot_header::csr_kind)
+            throw std::logic_error{"graph_snapshot::csr(): Snapshot does not hold a csr_storage"};
+
+        auto offsets = reinterpret_cast<const std::uint64_t*>(_section(_header.adjacency_offset));
+        return {offsets, offsets + nodes_count() + 1, nodes_count(), directed()};
+    }
+
+    template<typename Node>
+    const Node* payload() const
+    {
+        static_assert(std::is_trivially_copyable<Node>::value, "Snapshot payloads must be trivially copyable");
+        static_assert(alignof(Node) <= snapshot_detail::section_alignment, "Payload alignment exceeds the section alignment");
+
+        if(!has_payload() || _header.payload_stride != sizeof(Node))
+            throw std::logic_error{"graph_snapshot::payload(): Snapshot has no payload of this type"};
+
+        return reinterpret_cast<const Node*>(_section(_header.payload_offset));
+    }
+
+private:
+    const unsigned char* _section(std::uint64_t offset) const
+    {
+        return _file.data() + offset;
+    }
+
+    // The adjacency section must have exactly the size its kind implies, and every
+    // section must be aligned and lie inside the file
+    void _check_sections(const std::string& path) const
+    {
+        using snapshot_detail::checked_add;
+        using snapshot_detail::checked_mul;
+
+        std::uint64_t expected = 0, end = 0, words = 0;
+        bool fits = true;
+
+        switch(_header.kind)
+        {
+        case snapshot_header::matrix_kind:
+            // words_for_bits() without its rounding addition, which could wrap
+            if(_header.row_pitch < _header.nodes_count / bits_per_word + (_header.nodes_count % bits_per_word != 0))
+                throw std::runtime_error{"graph_snapshot: " + path + " has a row pitch too small for its nodes"};
+
+            fits = checked_mul(_header.nodes_count, _header.row_pitch, words);
+            break;
+        case snapshot_header::csr_kind:
+            fits = checked_add(_header.nodes_count, 1, words) && checked_add(words, _header.arcs_count, words);
+            break;
+        default:
+            throw std::runtime_error{"graph_snapshot: " + path + " holds an unknown adjacency kind"};
+        }
+
+        if(!fits || !checked_mul(words, sizeof(std::uint64_t), expected) || _header.adjacency_bytes != expected)
+            throw std::runtime_error{"graph_snapshot: " + path + " has an adjacency section of the wrong size"};
+        if(_header.adjacency_offset % snapshot_detail::section_alignment != 0 ||
+           (has_payload() && _header.payload_offset % snapshot_detail::section_alignment != 0))
+            throw std::runtime_error{"graph_snapshot: " + path + " has a misaligned section"};
+        if(!checked_add(_header.adjacency_offset, _header.adjacency_bytes, end) || end > _file.size())
+            throw std::runtime_error{"graph_snapshot: " + path + " is truncated"};
+
+        if(has_payload() && (!checked_mul(_header.payload_stride, _header.nodes_count, words) ||
+                             !checked_add(_header.payload_offset, words, end) || end > _file.size()))
+            throw std::runtime_error{"graph_snapshot: " + path + " is truncated"};
+    }
+
+    // mapped_csr indexes targets through the offsets unchecked, and consumers index their
+    // per-node arrays with the targets
+    void _check_csr(const std::string& path) const
+    {
+        auto offsets = reinterpret_cast<const std::uint64_t*>(_section(_header.adjacency_offset));
+        auto targets = offsets + _header.nodes_count + 1;
+
+        if(offsets[0] != 0 || offsets[_header.nodes_count] != _header.arcs_count)
+            throw std::runtime_error{"graph_snapshot: " + path + " has CSR offsets not spanning its arcs"};
+
+        for(std::uint64_t i = 0; i < _header.nodes_count; ++i)
+        {
+            if(offsets[i] > offsets[i + 1])
+                throw std::runtime_error{"graph_snapshot: " + path + " has decreasing CSR offsets"};
+        }
+
+        for(std::uint64_t k = 0; k < _header.arcs_count; ++k)
+        {
+            if(targets[k] >= _header.nodes_count)
+                throw std::runtime_error{"graph_snapshot: " + path + " has CSR targets out of range"};
+        }
+    }
+
+    // Columns past nodes_count, up to the row pitch, must be clear
+    void _check_matrix_padding(const std::string& path) const
+    {
+        auto words = reinterpret_cast<const bit_word*>(_section(_header.adjacency_offset));
+        const std::uint64_t live = _header.nodes_count / bits_per_word;
+        const std::uint64_t tail_bits = _header.nodes_count % bits_per_word;
+
+        for(std::uint64_t i = 0; i < _header.nodes_count; ++i)
+        {
+            const bit_word* row = words + i * _header.row_pitch;
+            bit_word stray = tail_bits != 0 ? row[live] & ~(bit_mask(tail_bits) - 1) : 0;
+
+            for(std::uint64_t w = live + (tail_bits != 0); w < _header.row_pitch; ++w)
+                stray |= row[w];
+
+            if(stray != 0)
+                throw std::runtime_error{"graph_snapshot: " + path + " has edges to columns past its nodes"};
+        }
+    }
+
+    mapped_file _file;
+    snapshot_header _header;
+};
+
+#endif //PRACTICA2MAR_SNAPSHOT_HPP
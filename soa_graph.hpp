@@ -0,0 +1,358 @@
+#ifndef PRACTICA2MAR_SOA_GRAPH_HPP
+#define PRACTICA2MAR_SOA_GRAPH_HPP
+
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <iostream>
+#include <type_traits>
+#include <stdexcept>
+
+#include "graph.hpp"
+#include "utils.hpp"
+
+// Field list of a Node stored column-wise, registered with GRAPH_SOA_FIELDS:
+//
+//     struct city { int population; double lat, lon; };
+//     GRAPH_SOA_FIELDS(city, &city::population, &city::lat, &city::lon)
+template<typename Node>
+struct soa_traits;
+
+#define GRAPH_SOA_FIELDS(type, ...) \
+    template<> struct soa_traits<type> { \
+        static auto members() AUTO_RETURN(std::make_tuple(__VA_ARGS__)) \
+    };
+
+namespace soa_detail
+{
+    template<typename Member>
+    struct member_type;
+
+    template<typename T, typename C>
+    struct member_type<T C::*>
+    {
+        using type = T;
+    };
+
+    template<typename Members>
+    struct columns;
+
+    template<typename... Members>
+    struct columns<std::tuple<Members...>>
+    {
+        using type = std::tuple<std::vector<typename member_type<Members>::type>...>;
+    };
+}
+
+// One std::vector per registered field of Node
+template<typename Node>
+struct soa_columns
+{
+    using members_t = decltype(soa_traits<Node>::members());
+    using columns_t = typename soa_detail::columns<members_t>::type;
+
+    static constexpr std::size_t fields = std::tuple_size<members_t>::value;
+    static_assert(fields > 0, "A SoA node needs at least one registered field");
+
+    template<std::size_t I>
+    using field_t = typename std::tuple_element<I, columns_t>::type::value_type;
+
+    std::size_t size() const
+    {
+        return std::get<0>(_columns).size();
+    }
+
+    void reserve(std::size_t count)
+    {
+        _reserve(count, std::make_index_sequence<fields>{});
+    }
+
+    void push_back(const Node& node)
+    {
+        _push_back(node, std::make_index_sequence<fields>{});
+    }
+
+    Node get(std::size_t i) const
+    {
+        Node node{};
+        _get(i, node, std::make_index_sequence<fields>{});
+        return node;
+    }
+
+    template<std::size_t I>
+    std::vector<field_t<I>>& column()
+    {
+        return std::get<I>(_columns);
+    }
+
+    template<std::size_t I>
+    const std::vector<field_t<I>>& column() const
+    {
+        return std::get<I>(_columns);
+    }
+
+    // Members of a type no field has are rejected at compile time; any other member
+    // that was not registered throws std::logic_error
+    template<typename T>
+    T& field(std::size_t i, T Node::* member)
+    {
+        static_assert(_has_field_of<T>(std::make_index_sequence<fields>{}), "soa_columns::field(): No registered field has this type");
+        return *_find<0>(i, member);
+    }
+
+    template<typename T>
+    const T& field(std::size_t i, T Node::* member) const
+    {
+        return const_cast<soa_columns&>(*this).field(i, member);
+    }
+
+private:
+    template<typename T, std::size_t... I>
+    static constexpr bool _has_field_of(std::index_sequence<I...>)
+    {
+        const bool same[] = {false, std::is_same<field_t<I>, T>::value...};
+
+        for(std::size_t k = 0; k < sizeof(same) / sizeof(same[0]); ++k)
+            if(same[k])
+                return true;
+
+        return false;
+    }
+
+    template<std::size_t... I>
+    void _reserve(std::size_t count, std::index_sequence<I...>)
+    {
+        int expand[] = {0, (std::get<I>(_columns).reserve(count), 0)...};
+        (void)expand;
+    }
+
+    template<std::size_t... I>
+    void _push_back(const Node& node, std::index_sequence<I...>)
+    {
+        auto members = soa_traits<Node>::members();
+        int expand[] = {0, (std::get<I>(_columns).push_back(node.*std::get<I>(members)), 0)...};
+        (void)expand;
+    }
+
+    template<std::size_t... I>
+    void _get(std::size_t i, Node& node, std::index_sequence<I...>) const
+    {
+        auto members = soa_traits<Node>::members();
+        int expand[] = {0, (node.*std::get<I>(members) = std::get<I>(_columns)[i], 0)...};
+        (void)expand;
+    }
+
+    template<std::size_t I, typename T>
+    T* _match(std::size_t i, T Node::* member, std::true_type)
+    {
+        if(std::get<I>(soa_traits<Node>::members()) == member)
+            return &std::get<I>(_columns)[i];
+
+        return _find<I + 1>(i, member);
+    }
+
+    template<std::size_t I, typename T>
+    T* _match(std::size_t i, T Node::* member, std::false_type)
+    {
+        return _find<I + 1>(i, member);
+    }
+
+    template<std::size_t I, typename T>
+    std::enable_if_t<(I < fields), T*> _find(std::size_t i, T Node::* member)
+    {
+        return _match<I>(i, member, std::is_same<field_t<I>, T>{});
+    }
+
+    template<std::size_t I, typename T>
+    std::enable_if_t<(I == fields), T*> _find(std::size_t, T Node::*)
+    {
+        throw std::logic_error{"soa_columns::field(): Member is not a registered SoA field"};
+    }
+
+    columns_t _columns;
+};
+
+// Node reference of a soa_graph: the graph and the node index, nothing else.
+// Graph may be const qualified for read-only handles.
+template<typename Graph>
+struct soa_node_handle
+{
+    soa_node_handle(Graph* graph, std::size_t id) :
+        _graph{graph},
+        _id{id}
+    {}
+
+    std::size_t id() const
+    {
+        return _id;
+    }
+
+    operator std::size_t() const
+    {
+        return id();
+    }
+
+    template<typename Member>
+    decltype(auto) operator[](Member member) const
+    {
+        return _graph->field(_id, member);
+    }
+
+    auto value() const
+    {
+        return _graph->get(_id);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const soa_node_handle& n)
+    {
+        return os << n.id();
+    }
+
+    friend bool operator==(const soa_node_handle& lhs, const soa_node_handle& rhs)
+    {
+        return lhs.id() == rhs.id();
+    }
+
+    friend bool operator!=(const soa_node_handle& lhs, const soa_node_handle& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    Graph* _graph;
+    std::size_t _id;
+};
+
+// graph<Node, Storage> with Node payloads split in per-field columns. Node ids are
+// plain indices and traversals yield soa_node_handle values instead of Node copies.
+template<typename Node, typename Storage = adjacency_matrix>
+struct soa_graph {
+    using storage_t = Storage;
+    using node_t = soa_node_handle<soa_graph>;
+    using const_node_t = soa_node_handle<const soa_graph>;
+
+    soa_graph(bool directed = false) : _matrix{ directed }
+    {}
+
+    void reserve(std::size_t count)
+    {
+        _matrix.reserve(count);
+        _nodes.reserve(count);
+    }
+
+    void add_node(const Node& node = Node{})
+    {
+        _nodes.push_back(node);
+        _matrix.add_node();
+    }
+
+    void add_nodes(std::size_t count, const Node& node = Node{})
+    {
+        _nodes.reserve(nodes_count() + count);
+
+        for(std::size_t i = 0; i < count; ++i)
+            _nodes.push_back(node);
+
+        _matrix.add_nodes(count);
+    }
+
+    auto neighbors(std::size_t node) const
+    {
+        return ranges::view::transform(_matrix.neighbors(node), [this](std::size_t i)
+        {
+            return const_node_t{this, i};
+        }) | ranges::view::bounded;
+    }
+
+    auto neighbors(std::size_t node)
+    {
+        return ranges::view::transform(_matrix.neighbors(node), [this](std::size_t i)
+        {
+            return node_t{this, i};
+        }) | ranges::view::bounded;
+    }
+
+    auto edges() const
+    {
+        return ranges::view::transform(_matrix.edges(), [this](auto edge)
+        {
+            return std::make_pair(const_node_t{this, edge.first}, const_node_t{this, edge.second});
+        });
+    }
+
+    const Storage& adjacency() const
+    {
+        return _matrix;
+    }
+
+    Storage& adjacency()
+    {
+        return _matrix;
+    }
+
+    const_node_t operator()(std::size_t i) const
+    {
+        return {this, i};
+    }
+
+    node_t operator()(std::size_t i)
+    {
+        return {this, i};
+    }
+
+    Node get(std::size_t i) const
+    {
+        return _nodes.get(i);
+    }
+
+    template<typename T>
+    T& field(std::size_t i, T Node::* member)
+    {
+        return _nodes.field(i, member);
+    }
+
+    template<typename T>
+    const T& field(std::size_t i, T Node::* member) const
+    {
+        return _nodes.field(i, member);
+    }
+
+    template<std::size_t I>
+    auto& column()
+    {
+        return _nodes.template column<I>();
+    }
+
+    template<std::size_t I>
+    const auto& column() const
+    {
+        return _nodes.template column<I>();
+    }
+
+    std::size_t nodes_count() const
+    {
+        return _nodes.size();
+    }
+
+    std::size_t degree(std::size_t node) const
+    {
+        return _matrix.degree(node);
+    }
+
+    void freeze()
+    {
+        _matrix.freeze();
+    }
+private:
+    soa_columns<Node> _nodes;
+    Storage _matrix;
+
+public:
+    METHOD_FROM(directed, _matrix)
+    METHOD_FROM(add_edges, _matrix)
+    METHOD_FROM(remove_edges, _matrix)
+    METHOD_FROM(operator(), _matrix)
+    METHOD_FROM(at, _matrix)
+};
+
+#endif //PRACTICA2MAR_SOA_GRAPH_HPP
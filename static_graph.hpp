@@ -0,0 +1,421 @@
+#ifndef PRACTICA2MAR_STATIC_GRAPH_HPP
+#define PRACTICA2MAR_STATIC_GRAPH_HPP
+
+#include <utility>
+#include <iterator>
+#include <array>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+#include <iostream>
+
+#include "bit_row.hpp"
+
+namespace static_graph_detail
+{
+    constexpr unsigned char de_bruijn_index[bits_per_word] = {
+        63, 0, 58, 1, 59, 47, 53, 2, 60, 39, 48, 27, 54, 33, 42, 3,
+        61, 51, 37, 40, 49, 18, 28, 20, 55, 30, 34, 11, 43, 14, 22, 4,
+        62, 57, 46, 52, 38, 26, 32, 41, 50, 36, 17, 19, 29, 10, 13, 21,
+        56, 45, 25, 31, 35, 16, 9, 12, 44, 24, 15, 8, 23, 7, 6, 5
+    };
+
+    // Constant expression versions of word_ctz() and word_popcount(), which go through
+    // intrinsics. w must not be zero.
+    constexpr std::size_t ctz(bit_word w)
+    {
+        return de_bruijn_index[((w & (~w + 1)) * bit_word{0x07EDD5E59A4E28C2}) >> 58];
+    }
+
+    constexpr std::size_t popcount(bit_word w)
+    {
+        w = w - ((w >> 1) & 0x5555555555555555);
+        w = (w & 0x3333333333333333) + ((w >> 2) & 0x3333333333333333);
+        w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0F;
+        return static_cast<std::size_t>((w * 0x0101010101010101) >> 56);
+    }
+}
+
+// Adjacency matrix with its size fixed at compile time: the rows are an in-place array of
+// words, so the graph lives on the stack (or in .rodata when constexpr) without a single
+// allocation, and every row loop has a constant trip count the compiler can unroll.
+// Everything but printing and the bit_row/vector accessors is usable in constant
+// expressions, including construction from an edge list:
+//
+//     constexpr static_graph<4> ring{{0, 1}, {1, 2}, {2, 3}, {3, 0}};
+//     static_assert(ring(3, 0) && ring.degree(1) == 2, "");
+template<std::size_t N, bool Directed = false>
+struct static_graph
+{
+    static_assert(N > 0, "static_graph<N>: Empty graph");
+
+private:
+    struct node_proxy;
+
+public:
+    using edge_t = std::pair<std::size_t, std::size_t>;
+    static constexpr std::size_t row_words = words_for_bits(N);
+
+    struct neighbor_iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::size_t*;
+        using reference = std::size_t;
+
+        constexpr neighbor_iterator() = default;
+
+        constexpr neighbor_iterator(const bit_word* row, std::size_t word) :
+            _row{row},
+            _word{word},
+            _current{word < row_words ? row[word] : 0}
+        {
+            _skip_empty();
+        }
+
+        constexpr std::size_t operator*() const
+        {
+            return _word * bits_per_word + static_graph_detail::ctz(_current);
+        }
+
+        constexpr neighbor_iterator& operator++()
+        {
+            _current &= _current - 1;
+            _skip_empty();
+            return *this;
+        }
+
+        constexpr neighbor_iterator operator++(int)
+        {
+            neighbor_iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        constexpr friend bool operator==(const neighbor_iterator& lhs, const neighbor_iterator& rhs)
+        {
+            return lhs._word == rhs._word && lhs._current == rhs._current;
+        }
+
+        constexpr friend bool operator!=(const neighbor_iterator& lhs, const neighbor_iterator& rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        constexpr void _skip_empty()
+        {
+            while(_current == 0 && _word < row_words && ++_word < row_words)
+                _current = _row[_word];
+        }
+
+        const bit_word* _row = nullptr;
+        std::size_t _word = row_words;
+        bit_word _current = 0;
+    };
+
+    struct neighbor_range
+    {
+        constexpr neighbor_iterator begin() const
+        {
+            return {row, 0};
+        }
+
+        constexpr neighbor_iterator end() const
+        {
+            return {row, row_words};
+        }
+
+        const bit_word* row;
+    };
+
+    // Undirected edges are reported once, from their lower endpoint
+    struct edge_iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = edge_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const edge_t*;
+        using reference = edge_t;
+
+        constexpr edge_iterator() = default;
+
+        constexpr edge_iterator(const static_graph* graph, std::size_t row) :
+            _graph{graph},
+            _row{row},
+            _neighbor{row < N ? graph->_row(row) : nullptr, row < N ? 0 : row_words}
+        {
+            _settle();
+        }
+
+        constexpr edge_t operator*() const
+        {
+            return {_row, *_neighbor};
+        }
+
+        constexpr edge_iterator& operator++()
+        {
+            ++_neighbor;
+            _settle();
+            return *this;
+        }
+
+        constexpr edge_iterator operator++(int)
+        {
+            edge_iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        constexpr friend bool operator==(const edge_iterator& lhs, const edge_iterator& rhs)
+        {
+            return lhs._row == rhs._row && lhs._neighbor == rhs._neighbor;
+        }
+
+        constexpr friend bool operator!=(const edge_iterator& lhs, const edge_iterator& rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        constexpr void _settle()
+        {
+            while(_row < N)
+            {
+                if(_neighbor == neighbor_iterator{})
+                {
+                    if(++_row < N)
+                        _neighbor = {_graph->_row(_row), 0};
+                }
+                else if(Directed || *_neighbor >= _row)
+                    return;
+                else
+                    ++_neighbor;
+            }
+        }
+
+        const static_graph* _graph = nullptr;
+        std::size_t _row = N;
+        neighbor_iterator _neighbor;
+    };
+
+    struct edge_range
+    {
+        constexpr edge_iterator begin() const
+        {
+            return {graph, 0};
+        }
+
+        constexpr edge_iterator end() const
+        {
+            return {graph, N};
+        }
+
+        const static_graph* graph;
+    };
+
+    constexpr static_graph() = default;
+
+    constexpr static_graph(std::initializer_list<std::initializer_list<int>> pairs)
+    {
+        add_edges(pairs);
+    }
+
+    template<std::size_t E>
+    constexpr static_graph(const std::array<edge_t, E>& edges)
+    {
+        add_edges(edges);
+    }
+
+    static constexpr bool directed() noexcept
+    {
+        return Directed;
+    }
+
+    static constexpr std::size_t nodes_count() noexcept
+    {
+        return N;
+    }
+
+    static constexpr std::size_t row_pitch() noexcept
+    {
+        return row_words;
+    }
+
+    constexpr bool operator()(std::size_t i, std::size_t j) const {
+        assert(i < N && j < N);
+        return (_row(i)[j / bits_per_word] & bit_mask(j)) != 0;
+    }
+
+    constexpr node_proxy operator()(std::size_t i, std::size_t j) {
+        assert(i < N && j < N);
+        return {this, i, j};
+    }
+
+    constexpr bool at(std::size_t i, std::size_t j) const {
+        if (i < N && j < N)
+            return (*this)(i, j);
+        else
+            throw std::out_of_range{"static_graph::at(i,j): Index out of range"};
+    }
+
+    constexpr node_proxy at(std::size_t i, std::size_t j) {
+        if (i < N && j < N)
+            return (*this)(i, j);
+        else
+            throw std::out_of_range{"static_graph::at(i,j): Index out of range"};
+    }
+
+    constexpr void add_edges(std::initializer_list<std::initializer_list<int>> pairs) {
+        _apply_edges(pairs, true);
+    }
+
+    template<std::size_t E>
+    constexpr void add_edges(const std::array<edge_t, E>& edges) {
+        // std::array has no constexpr begin() before C++17, its const operator[] is fine
+        for(std::size_t k = 0; k < E; ++k)
+            _set(edges[k].first, edges[k].second, true);
+    }
+
+    constexpr void remove_edges(std::initializer_list<std::initializer_list<int>> pairs) {
+        _apply_edges(pairs, false);
+    }
+
+    template<std::size_t E>
+    constexpr void remove_edges(const std::array<edge_t, E>& edges) {
+        for(std::size_t k = 0; k < E; ++k)
+            _set(edges[k].first, edges[k].second, false);
+    }
+
+    constexpr void clear()
+    {
+        for(std::size_t w = 0; w < N * row_words; ++w)
+            _words[w] = 0;
+    }
+
+    constexpr std::size_t degree(std::size_t node) const
+    {
+        assert(node < N);
+        std::size_t result = 0;
+
+        for(std::size_t w = 0; w < row_words; ++w)
+            result += static_graph_detail::popcount(_row(node)[w]);
+
+        return result;
+    }
+
+    constexpr neighbor_range neighbors(std::size_t node) const
+    {
+        assert(node < N);
+        return {_row(node)};
+    }
+
+    constexpr edge_range edges() const
+    {
+        return {this};
+    }
+
+    constexpr std::size_t count_common_neighbors(std::size_t i, std::size_t j) const
+    {
+        assert(i < N && j < N);
+        std::size_t result = 0;
+
+        for(std::size_t w = 0; w < row_words; ++w)
+            result += static_graph_detail::popcount(_row(i)[w] & _row(j)[w]);
+
+        return result;
+    }
+
+    std::vector<std::size_t> common_neighbors(std::size_t i, std::size_t j) const
+    {
+        std::vector<std::size_t> result;
+
+        for(std::size_t w = 0; w < row_words; ++w)
+            for(bit_word common = _row(i)[w] & _row(j)[w]; common != 0; common &= common - 1)
+                result.push_back(w * bits_per_word + word_ctz(common));
+
+        return result;
+    }
+
+    // Same row view as adjacency_matrix, for the bit_row kernels
+    bit_row row(std::size_t node) const
+    {
+        assert(node < N);
+        return {_row(node), row_words};
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const static_graph& g)
+    {
+        for(std::size_t i = 0; i < N; ++i)
+        {
+            for(std::size_t j = 0; j < N; ++j)
+                os << g(i, j) << " ";
+
+            os << "\n";
+        }
+
+        return os;
+    }
+
+private:
+    constexpr const bit_word* _row(std::size_t node) const
+    {
+        return _words + node * row_words;
+    }
+
+    constexpr void _set(std::size_t i, std::size_t j, bool value)
+    {
+        assert(i < N && j < N);
+        _write(i, j, value);
+
+        if(!Directed)
+            _write(j, i, value);
+    }
+
+    constexpr void _write(std::size_t i, std::size_t j, bool value)
+    {
+        bit_word& word = _words[i * row_words + j / bits_per_word];
+        word = value ? (word | bit_mask(j)) : (word & ~bit_mask(j));
+    }
+
+    constexpr void _apply_edges(std::initializer_list<std::initializer_list<int>> pairs, bool value)
+    {
+        for(auto pair : pairs)
+        {
+            assert(pair.size() == 2);
+            _set(static_cast<std::size_t>(*pair.begin()), static_cast<std::size_t>(*(pair.begin() + 1)), value);
+        }
+    }
+
+    struct node_proxy
+    {
+        constexpr node_proxy(static_graph* graph, std::size_t _i, std::size_t _j) :
+            _ref{graph},
+            i{_i},
+            j{_j}
+        {}
+
+        constexpr bool operator=(bool b)
+        {
+            _ref->_set(i, j, b);
+            return b;
+        }
+
+        constexpr operator bool() const
+        {
+            return (*static_cast<const static_graph*>(_ref))(i, j);
+        }
+
+        static_graph* _ref;
+        std::size_t i, j;
+    };
+
+    // A C array rather than std::array: its non-const operator[] is not constexpr in C++14
+    bit_word _words[N * row_words] = {};
+};
+
+template<std::size_t N, bool Directed>
+constexpr std::size_t static_graph<N, Directed>::row_words;
+
+#endif //PRACTICA2MAR_STATIC_GRAPH_HPP
@@ -0,0 +1,38 @@
+#include "closure.hpp"
+
+#include <iostream>
+
+// Inputs grown one node at a time have a row pitch sized for their capacity, wider than
+// the one of a matrix built with the same number of nodes
+int main()
+{
+    const std::size_t n = 1025;
+    adjacency_matrix chain{true};
+
+    for(std::size_t i = 0; i < n; ++i)
+        chain.add_node();
+
+    for(std::size_t i = 0; i + 1 < n; ++i)
+        chain(i, i + 1) = true;
+
+    if(chain.row_pitch() <= words_for_bits(n))
+    {
+        std::cerr << "input pitch is not wider than the result one\n";
+        return 1;
+    }
+
+    adjacency_matrix closure = transitive_closure(chain);
+    adjacency_matrix square = multiply(chain, chain);
+
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        for(std::size_t j = 0; j < n; ++j)
+        {
+            if(closure(i, j) != (i < j) || square(i, j) != (j == i + 2))
+            {
+                std::cerr << "wrong result at (" << i << ", " << j << ")\n";
+                return 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef PRACTICA2MAR_THREAD_POOL_HPP
+#define PRACTICA2MAR_THREAD_POOL_HPP
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <algorithm>
+
+// Fixed set of workers running one job at a time. The calling thread takes part as
+// worker 0, so a pool of size 1 runs everything inline.
+struct thread_pool
+{
+    explicit thread_pool(std::size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for(std::size_t i = 1; i < std::max<std::size_t>(threads, 1); ++i)
+            _workers.emplace_back([this, i]{ _work(i); });
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _stop = true;
+        }
+
+        _wake.notify_all();
+
+        for(auto& worker : _workers)
+            worker.join();
+    }
+
+    std::size_t size() const noexcept
+    {
+        return _workers.size() + 1;
+    }
+
+    // Runs job(worker_index) once on every worker and returns when all of them finished
+    void run(const std::function<void(std::size_t)>& job)
+    {
+        std::lock_guard<std::mutex> run_lock{_run_mutex};
+
+        if(_workers.empty())
+            return job(0);
+
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _job = &job;
+            _pending = _workers.size();
+            ++_generation;
+        }
+
+        _wake.notify_all();
+        job(0);
+
+        std::unique_lock<std::mutex> lock{_mutex};
+        _done.wait(lock, [this]{ return _pending == 0; });
+        _job = nullptr;
+    }
+
+    // Splits [begin, end) in chunks of grain items handed out dynamically;
+    // f is called as f(worker_index, chunk_begin, chunk_end)
+    template<typename F>
+    void parallel_for(std::size_t begin, std::size_t end, std::size_t grain, F f)
+    {
+        if(begin >= end)
+            return;
+
+        grain = std::max<std::size_t>(grain, 1);
+        std::atomic<std::size_t> next{begin};
+
+        run([&](std::size_t worker)
+        {
+            for(std::size_t b = next.fetch_add(grain); b < end; b = next.fetch_add(grain))
+                f(worker, b, std::min(end, b + grain));
+        });
+    }
+
+    static thread_pool& default_pool()
+    {
+        static thread_pool pool;
+        return pool;
+    }
+
+private:
+    void _work(std::size_t index)
+    {
+        std::size_t seen = 0;
+
+        for(;;)
+        {
+            const std::function<void(std::size_t)>* job;
+
+            {
+                std::unique_lock<std::mutex> lock{_mutex};
+                _wake.wait(lock, [&]{ return _stop || _generation != seen; });
+
+                if(_stop)
+                    return;
+
+                seen = _generation;
+                job = _job;
+            }
+
+            (*job)(index);
+
+            std::lock_guard<std::mutex> lock{_mutex};
+
+            if(--_pending == 0)
+                _done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> _workers;
+    std::mutex _mutex, _run_mutex;
+    std::condition_variable _wake, _done;
+    const std::function<void(std::size_t)>* _job = nullptr;
+    std::size_t _pending = 0;
+    std::size_t _generation = 0;
+    bool _stop = false;
+};
+
+#endif //PRACTICA2MAR_THREAD_POOL_HPP
@@ -0,0 +1,77 @@
+#ifndef PRACTICA2MAR_TRIANGLES_HPP
+#define PRACTICA2MAR_TRIANGLES_HPP
+
+#include <vector>
+#include <numeric>
+#include <stdexcept>
+
+#include "graph.hpp"
+#include "thread_pool.hpp"
+
+namespace triangles_detail
+{
+    // Common neighbors of the edge (i, j), leaving out i and j themselves when they have self loops
+    template<typename Storage>
+    std::size_t edge_support(const Storage& storage, std::size_t i, std::size_t j)
+    {
+        return storage.count_common_neighbors(i, j) - (storage(i, i) ? 1 : 0) - (storage(j, j) ? 1 : 0);
+    }
+}
+
+// Each triangle is seen once from each of its three edges
+template<typename Storage>
+std::size_t count_triangles(const Storage& storage, thread_pool& pool = thread_pool::default_pool(), std::size_t grain = 64)
+{
+    if(storage.directed())
+        throw std::logic_error{"count_triangles(): Only undirected graphs are supported"};
+
+    std::vector<std::size_t> counts(pool.size(), 0);
+
+    pool.parallel_for(0, storage.nodes_count(), grain, [&](std::size_t worker, std::size_t b, std::size_t e)
+    {
+        std::size_t count = 0;
+
+        for(std::size_t i = b; i < e; ++i)
+            for(std::size_t j : storage.neighbors(i))
+                if(j > i)
+                    count += triangles_detail::edge_support(storage, i, j);
+
+        counts[worker] += count;
+    });
+
+    return std::accumulate(counts.begin(), counts.end(), std::size_t{0}) / 3;
+}
+
+template<typename Storage>
+double clustering_coefficient(const Storage& storage, std::size_t node)
+{
+    if(storage.directed())
+        throw std::logic_error{"clustering_coefficient(): Only undirected graphs are supported"};
+
+    std::size_t degree = 0, links = 0;
+
+    for(std::size_t j : storage.neighbors(node))
+    {
+        if(j == node)
+            continue;
+
+        ++degree;
+        links += triangles_detail::edge_support(storage, node, j);
+    }
+
+    return degree < 2 ? 0.0 : static_cast<double>(links) / static_cast<double>(degree * (degree - 1));
+}
+
+template<typename Node, typename Storage>
+std::size_t count_triangles(const graph<Node, Storage>& g, thread_pool& pool = thread_pool::default_pool(), std::size_t grain = 64)
+{
+    return count_triangles(g.adjacency(), pool, grain);
+}
+
+template<typename Node, typename Storage>
+double clustering_coefficient(const graph<Node, Storage>& g, std::size_t node)
+{
+    return clustering_coefficient(g.adjacency(), node);
+}
+
+#endif //PRACTICA2MAR_TRIANGLES_HPP
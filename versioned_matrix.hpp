@@ -0,0 +1,555 @@
+#ifndef PRACTICA2MAR_VERSIONED_MATRIX_HPP
+#define PRACTICA2MAR_VERSIONED_MATRIX_HPP
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+
+#include <manu343726/range/v3/all.hpp>
+#include "bit_row.hpp"
+#include "aligned_allocator.hpp"
+
+// Epoch based reclamation. Readers pin the global epoch they entered in while they hold
+// a pointer; memory retired at epoch r is only freed once every pinned epoch is above r.
+struct epoch_domain
+{
+    static constexpr std::size_t max_readers = 256;
+
+    epoch_domain()
+    {
+        for(auto& slot : _slots)
+            slot.store(0, std::memory_order_relaxed);
+    }
+
+    // Returns the slot holding the pin
+    std::size_t enter()
+    {
+        std::size_t pin = (_epoch.load() << 1) | 1;
+
+        for(std::size_t i = 0; i < max_readers; ++i)
+        {
+            std::size_t expected = 0;
+
+            if(_slots[i].load(std::memory_order_relaxed) == 0 && _slots[i].compare_exchange_strong(expected, pin))
+                return i;
+        }
+
+        throw std::runtime_error{"epoch_domain::enter(): Too many concurrent readers"};
+    }
+
+    void leave(std::size_t slot)
+    {
+        _slots[slot].store(0, std::memory_order_release);
+    }
+
+    // Epoch to tag memory retired now; moves the global epoch forward
+    std::size_t retire_epoch()
+    {
+        return _epoch.fetch_add(1);
+    }
+
+    // Retired memory tagged with an epoch below this value is no longer reachable
+    std::size_t safe_epoch() const
+    {
+        std::size_t result = std::numeric_limits<std::size_t>::max();
+
+        for(const auto& slot : _slots)
+        {
+            std::size_t pin = slot.load();
+
+            if(pin != 0)
+                result = std::min(result, pin >> 1);
+        }
+
+        return result;
+    }
+
+private:
+    std::atomic<std::size_t> _epoch{1};
+    std::atomic<std::size_t> _slots[max_readers];
+};
+
+namespace versioned_detail
+{
+    constexpr std::size_t rows_per_block = 64;
+
+    struct row_block
+    {
+        std::vector<bit_word, aligned_allocator<bit_word>> words;
+    };
+
+    struct version
+    {
+        std::size_t nodes_count = 0;
+        std::size_t capacity = 0;
+        std::size_t row_pitch = 0;
+        bool directed = false;
+        std::vector<row_block*> blocks;
+    };
+
+    // Any storage exposing nodes_count(), directed() and neighbors(i)
+    template<typename View>
+    struct edge_iterator
+    {
+        using edge_t = std::pair<std::size_t, std::size_t>;
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = edge_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const edge_t*;
+        using reference = edge_t;
+
+        edge_iterator() = default;
+
+        edge_iterator(const View* view, std::size_t row) :
+            _view{view},
+            _row{row}
+        {
+            if(_row < _view->nodes_count())
+            {
+                _column = _first_column(_row);
+                _settle();
+            }
+        }
+
+        edge_t operator*() const
+        {
+            return std::make_pair(_row, *_column);
+        }
+
+        edge_iterator& operator++()
+        {
+            ++_column;
+            _settle();
+            return *this;
+        }
+
+        edge_iterator operator++(int)
+        {
+            edge_iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        friend bool operator==(const edge_iterator& lhs, const edge_iterator& rhs)
+        {
+            return lhs._row == rhs._row && lhs._column == rhs._column;
+        }
+
+        friend bool operator!=(const edge_iterator& lhs, const edge_iterator& rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        set_bit_iterator _first_column(std::size_t row) const
+        {
+            return {_view->row(row), _view->directed() ? 0 : row};
+        }
+
+        void _settle()
+        {
+            while(_column == set_bit_iterator::end(_view->row(_row)))
+            {
+                if(++_row == _view->nodes_count())
+                {
+                    _column = {};
+                    return;
+                }
+
+                _column = _first_column(_row);
+            }
+        }
+
+        const View* _view = nullptr;
+        std::size_t _row = 0;
+        set_bit_iterator _column;
+    };
+
+    // Read interface over one version table
+    template<typename Derived>
+    struct version_reader
+    {
+        bool directed() const noexcept
+        {
+            return _version().directed;
+        }
+
+        std::size_t nodes_count() const
+        {
+            return _version().nodes_count;
+        }
+
+        bit_row row(std::size_t node) const
+        {
+            assert(node < nodes_count());
+            const version& v = _version();
+            return {v.blocks[node / rows_per_block]->words.data() + (node % rows_per_block) * v.row_pitch, v.row_pitch};
+        }
+
+        std::size_t degree(std::size_t node) const
+        {
+            return row(node).count();
+        }
+
+        bool operator()(std::size_t i, std::size_t j) const noexcept {
+            assert(i < nodes_count() && j < nodes_count());
+            return row(i).test(j);
+        }
+
+        bool at(std::size_t i, std::size_t j) const {
+            if (i < nodes_count() && j < nodes_count())
+                return (*this)(i, j);
+            else
+                throw std::out_of_range{"versioned_matrix::at(i,j): Index out of range"};
+        }
+
+        auto neighbors(std::size_t node) const
+        {
+            return ranges::make_iterator_range(set_bit_iterator{row(node)}, set_bit_iterator::end(row(node)));
+        }
+
+        auto edges() const
+        {
+            const Derived* self = static_cast<const Derived*>(this);
+            return ranges::make_iterator_range(edge_iterator<Derived>{self, 0}, edge_iterator<Derived>{self, nodes_count()});
+        }
+
+    private:
+        const version& _version() const
+        {
+            return *static_cast<const Derived*>(this)->_table();
+        }
+    };
+}
+
+struct versioned_matrix;
+
+// Immutable view of the version published when it was taken. Holds an epoch pin, so the
+// rows it points to stay alive until it is destroyed.
+struct matrix_snapshot : versioned_detail::version_reader<matrix_snapshot>
+{
+    using edge_t = std::pair<std::size_t, std::size_t>;
+
+    matrix_snapshot(const matrix_snapshot&) = delete;
+    matrix_snapshot& operator=(const matrix_snapshot&) = delete;
+
+    matrix_snapshot(matrix_snapshot&& other) noexcept :
+        _domain{other._domain},
+        _slot{other._slot},
+        _table_ptr{other._table_ptr}
+    {
+        other._domain = nullptr;
+    }
+
+    matrix_snapshot& operator=(matrix_snapshot&& other) noexcept
+    {
+        std::swap(_domain, other._domain);
+        std::swap(_slot, other._slot);
+        std::swap(_table_ptr, other._table_ptr);
+        return *this;
+    }
+
+    ~matrix_snapshot()
+    {
+        if(_domain)
+            _domain->leave(_slot);
+    }
+
+private:
+    friend struct versioned_matrix;
+    friend struct versioned_detail::version_reader<matrix_snapshot>;
+
+    matrix_snapshot(epoch_domain* domain, std::size_t slot, const versioned_detail::version* table) :
+        _domain{domain},
+        _slot{slot},
+        _table_ptr{table}
+    {}
+
+    const versioned_detail::version* _table() const
+    {
+        return _table_ptr;
+    }
+
+    epoch_domain* _domain;
+    std::size_t _slot;
+    const versioned_detail::version* _table_ptr;
+};
+
+// Adjacency matrix with multi-version concurrency: one writer thread edits a private
+// working version, cloning each block of rows the first time it touches it, and
+// publish() swaps it in for new snapshots. Replaced tables and blocks are reclaimed
+// through an epoch_domain once no snapshot can still reach them.
+struct versioned_matrix : versioned_detail::version_reader<versioned_matrix>
+{
+private:
+    struct node_proxy;
+    using version = versioned_detail::version;
+    using row_block = versioned_detail::row_block;
+    static constexpr std::size_t rows_per_block = versioned_detail::rows_per_block;
+
+public:
+    using edge_t = std::pair<std::size_t, std::size_t>;
+
+    versioned_matrix(bool directed = false) :
+        versioned_matrix{0, directed}
+    {}
+
+    versioned_matrix(std::size_t nodes_count, bool directed = false)
+    {
+        _working = new version;
+        _working->directed = directed;
+        _grow(*_working, nodes_count);
+        _working->nodes_count = nodes_count;
+        _owned.assign(_working->blocks.size(), true);
+        publish();
+    }
+
+    versioned_matrix(const versioned_matrix&) = delete;
+    versioned_matrix& operator=(const versioned_matrix&) = delete;
+
+    // Every snapshot must have been released
+    ~versioned_matrix()
+    {
+        _collect(std::numeric_limits<std::size_t>::max());
+
+        for(row_block* block : _working->blocks)
+            delete block;
+        for(row_block* block : _replaced)
+            delete block;
+
+        delete _working;
+        delete _current.load();
+    }
+
+    matrix_snapshot snapshot() const
+    {
+        std::size_t slot = _domain.enter();
+        return {&_domain, slot, _current.load()};
+    }
+
+    void publish()
+    {
+        version* next = new version(*_working);
+        const version* previous = _current.exchange(_working);
+
+        if(previous != nullptr)
+            _retired.push_back({_domain.retire_epoch(), previous, std::move(_replaced)});
+
+        _working = next;
+        _replaced.clear();
+        _owned.assign(_working->blocks.size(), false);
+        _collect(_domain.safe_epoch());
+    }
+
+    void clear()
+    {
+        for(std::size_t b = 0; b < _working->blocks.size(); ++b)
+            std::fill(_own_block(b).begin(), _own_block(b).end(), bit_word{0});
+    }
+
+    void set(std::size_t i, std::size_t j, bool value)
+    {
+        assert(i < nodes_count() && j < nodes_count());
+        _write(i, j, value);
+
+        if(!directed())
+            _write(j, i, value);
+    }
+
+    void add_edges(std::initializer_list<std::initializer_list<int>> pairs) {
+        _apply_edges(pairs, true);
+    }
+
+    void remove_edges(std::initializer_list<std::initializer_list<int>> pairs) {
+        _apply_edges(pairs, false);
+    }
+
+    void add_edges(const std::vector<edge_t>& edges) {
+        for(const auto& edge : edges)
+            set(edge.first, edge.second, true);
+    }
+
+    using versioned_detail::version_reader<versioned_matrix>::operator();
+
+    node_proxy operator()(std::size_t i, std::size_t j) noexcept {
+        assert(i < nodes_count() && j < nodes_count());
+        return {this, i, j};
+    }
+
+    void reserve(std::size_t nodes_count)
+    {
+        if(nodes_count > _working->capacity)
+            _relayout(nodes_count);
+    }
+
+    void add_node()
+    {
+        add_nodes(1);
+    }
+
+    void add_nodes(std::size_t count)
+    {
+        std::size_t required = nodes_count() + count;
+
+        if(required > _working->capacity)
+            _relayout(std::max(required, 2 * _working->capacity));
+
+        _working->nodes_count = required;
+    }
+
+private:
+    friend struct versioned_detail::version_reader<versioned_matrix>;
+
+    struct retired
+    {
+        std::size_t epoch;
+        const version* table;
+        std::vector<row_block*> blocks;
+    };
+
+    const version* _table() const
+    {
+        return _working;
+    }
+
+    static std::size_t _pitch_for(std::size_t capacity)
+    {
+        return round_to_cache_line(words_for_bits(capacity));
+    }
+
+    // Adds zeroed blocks up to the given capacity, keeping the current pitch
+    static void _grow(version& v, std::size_t capacity)
+    {
+        if(v.row_pitch == 0)
+            v.row_pitch = _pitch_for(capacity);
+
+        std::size_t blocks = (capacity + rows_per_block - 1) / rows_per_block;
+
+        while(v.blocks.size() < blocks)
+            v.blocks.push_back(new row_block{{std::vector<bit_word, aligned_allocator<bit_word>>(rows_per_block * v.row_pitch, 0)}});
+
+        v.capacity = std::max(v.capacity, blocks * rows_per_block);
+    }
+
+    // A wider pitch rewrites every block, all of them are replaced
+    void _relayout(std::size_t capacity)
+    {
+        std::size_t pitch = _pitch_for(capacity);
+
+        if(pitch == _working->row_pitch)
+        {
+            _grow(*_working, capacity);
+            _owned.resize(_working->blocks.size(), true);
+            return;
+        }
+
+        version wider;
+        wider.directed = _working->directed;
+        wider.nodes_count = _working->nodes_count;
+        wider.row_pitch = pitch;
+        _grow(wider, capacity);
+
+        for(std::size_t i = 0; i < nodes_count(); ++i)
+        {
+            bit_row source = row(i);
+            std::copy(source.begin(), source.end(),
+                      wider.blocks[i / rows_per_block]->words.data() + (i % rows_per_block) * pitch);
+        }
+
+        for(std::size_t b = 0; b < _working->blocks.size(); ++b)
+        {
+            if(_owned[b])
+                delete _working->blocks[b];
+            else
+                _replaced.push_back(_working->blocks[b]);
+        }
+
+        *_working = std::move(wider);
+        _owned.assign(_working->blocks.size(), true);
+    }
+
+    std::vector<bit_word, aligned_allocator<bit_word>>& _own_block(std::size_t b)
+    {
+        if(!_owned[b])
+        {
+            _replaced.push_back(_working->blocks[b]);
+            _working->blocks[b] = new row_block(*_working->blocks[b]);
+            _owned[b] = true;
+        }
+
+        return _working->blocks[b]->words;
+    }
+
+    void _write(std::size_t i, std::size_t j, bool value)
+    {
+        bit_word& word = _own_block(i / rows_per_block)[(i % rows_per_block) * _working->row_pitch + j / bits_per_word];
+
+        if(value)
+            word |= bit_mask(j);
+        else
+            word &= ~bit_mask(j);
+    }
+
+    void _apply_edges(std::initializer_list<std::initializer_list<int>> pairs, bool value)
+    {
+        for(auto pair : pairs)
+        {
+            assert(std::end(pair) - std::begin(pair) == 2);
+            set(*(std::begin(pair)), *(std::begin(pair) + 1), value);
+        }
+    }
+
+    void _collect(std::size_t safe_epoch)
+    {
+        auto reclaimable = std::partition(_retired.begin(), _retired.end(), [=](const retired& r)
+        {
+            return r.epoch >= safe_epoch;
+        });
+
+        for(auto it = reclaimable; it != _retired.end(); ++it)
+        {
+            for(row_block* block : it->blocks)
+                delete block;
+
+            delete it->table;
+        }
+
+        _retired.erase(reclaimable, _retired.end());
+    }
+
+    struct node_proxy
+    {
+        node_proxy(versioned_matrix* matrix, std::size_t _i, std::size_t _j) :
+            _ref{matrix},
+            i{_i},
+            j{_j}
+        {}
+
+        bool operator=(bool b)
+        {
+            _ref->set(i, j, b);
+            return b;
+        }
+
+        operator bool() const
+        {
+            return static_cast<const versioned_matrix&>(*_ref)(i, j);
+        }
+
+        versioned_matrix* _ref;
+        std::size_t i, j;
+    };
+
+    version* _working = nullptr;
+    std::vector<bool> _owned;
+    std::vector<row_block*> _replaced;
+    std::atomic<const version*> _current{nullptr};
+    std::vector<retired> _retired;
+    mutable epoch_domain _domain;
+};
+
+#endif //PRACTICA2MAR_VERSIONED_MATRIX_HPP
@@ -0,0 +1,263 @@
+#ifndef PRACTICA2MAR_WEIGHTED_STORAGE_HPP
+#define PRACTICA2MAR_WEIGHTED_STORAGE_HPP
+
+#include <utility>
+#include <vector>
+#include <limits>
+#include <stdexcept>
+#include <cassert>
+#include <iostream>
+#include <algorithm>
+
+#include <manu343726/range/v3/all.hpp>
+#include "csr_storage.hpp"
+
+template<typename Weight>
+struct weighted_edge
+{
+    std::size_t from, to;
+    Weight weight;
+};
+
+template<typename Weight>
+constexpr Weight no_weight()
+{
+    return std::numeric_limits<Weight>::has_infinity ? std::numeric_limits<Weight>::infinity()
+                                                     : std::numeric_limits<Weight>::max();
+}
+
+// Sparse weighted adjacency with the csr_storage layout plus a weight array parallel to
+// the targets. Writes are buffered until freeze(), the last write of an edge wins.
+template<typename Weight>
+struct weighted_csr {
+private:
+    struct node_proxy;
+
+public:
+    using edge_t = std::pair<std::size_t, std::size_t>;
+    using weight_t = Weight;
+
+    using edge_iterator = csr_detail::edge_iterator<weighted_csr>;
+
+    weighted_csr(bool directed = false) : _directed{ directed }
+    {}
+
+    weighted_csr(std::size_t nodes_count, bool directed = false) :
+        _offsets(nodes_count + 1, 0),
+        _directed{directed}
+    {}
+
+    weighted_csr(std::initializer_list<weighted_edge<Weight>> edges, std::size_t nodes_count, bool directed = false) :
+        weighted_csr{nodes_count, directed}
+    {
+        add_edges(edges);
+        freeze();
+    }
+
+    bool directed() const noexcept
+    {
+        return _directed;
+    }
+
+    std::size_t nodes_count() const
+    {
+        return _offsets.size() - 1;
+    }
+
+    std::size_t arcs_count() const
+    {
+        return _targets.size();
+    }
+
+    const std::vector<std::size_t>& offsets() const noexcept
+    {
+        return _offsets;
+    }
+
+    const std::vector<std::size_t>& targets() const noexcept
+    {
+        return _targets;
+    }
+
+    // Weight of the arc stored at targets()[k]
+    Weight arc_weight(std::size_t k) const
+    {
+        assert(k < _weights.size());
+        return _weights[k];
+    }
+
+    bool frozen() const noexcept
+    {
+        return _pending.empty();
+    }
+
+    void clear()
+    {
+        std::fill(_offsets.begin(), _offsets.end(), std::size_t{0});
+        _targets.clear();
+        _weights.clear();
+        _pending.clear();
+    }
+
+    std::size_t degree(std::size_t node) const
+    {
+        assert(node < nodes_count());
+        return _offsets[node + 1] - _offsets[node];
+    }
+
+    auto neighbors(std::size_t node) const
+    {
+        assert(node < nodes_count());
+        return ranges::make_iterator_range(_targets.data() + _offsets[node], _targets.data() + _offsets[node + 1]);
+    }
+
+    // Weights of the arcs leaving node, in the same order as neighbors(node)
+    auto weights(std::size_t node) const
+    {
+        assert(node < nodes_count());
+        return ranges::make_iterator_range(_weights.data() + _offsets[node], _weights.data() + _offsets[node + 1]);
+    }
+
+    auto edges() const
+    {
+        return ranges::make_iterator_range(edge_iterator{this, 0, 0},
+                                           edge_iterator{this, nodes_count(), _targets.size()});
+    }
+
+    void add_edge(std::size_t i, std::size_t j, Weight weight)
+    {
+        assert(i < nodes_count() && j < nodes_count());
+        _pending.push_back({i, j, weight, true});
+    }
+
+    void remove_edge(std::size_t i, std::size_t j)
+    {
+        assert(i < nodes_count() && j < nodes_count());
+        _pending.push_back({i, j, Weight{}, false});
+    }
+
+    void add_edges(std::initializer_list<weighted_edge<Weight>> edges) {
+        for(const auto& edge : edges)
+            add_edge(edge.from, edge.to, edge.weight);
+    }
+
+    void add_edges(const std::vector<weighted_edge<Weight>>& edges) {
+        _pending.reserve(_pending.size() + edges.size());
+
+        for(const auto& edge : edges)
+            add_edge(edge.from, edge.to, edge.weight);
+    }
+
+    void remove_edges(std::initializer_list<std::initializer_list<int>> pairs) {
+        for(auto pair : pairs)
+        {
+            assert(std::end(pair) - std::begin(pair) == 2);
+            remove_edge(*(std::begin(pair)), *(std::begin(pair) + 1));
+        }
+    }
+
+    bool operator()(std::size_t i, std::size_t j) const noexcept {
+        assert(i < nodes_count() && j < nodes_count());
+        return _find(i,j) != no_node_slot;
+    }
+
+    node_proxy operator()(std::size_t i, std::size_t j) noexcept {
+        assert(i < nodes_count() && j < nodes_count());
+        return {this, i, j};
+    }
+
+    bool at(std::size_t i, std::size_t j) const {
+        if (i < nodes_count() && j < nodes_count())
+            return (*this)(i, j);
+        else
+            throw std::out_of_range{"weighted_csr::at(i,j): Index out of range"};
+    }
+
+    // no_weight<Weight>() when there is no such edge
+    Weight weight(std::size_t i, std::size_t j) const
+    {
+        assert(i < nodes_count() && j < nodes_count());
+        std::size_t slot = _find(i,j);
+        return slot != no_node_slot ? _weights[slot] : no_weight<Weight>();
+    }
+
+    void reserve(std::size_t nodes_count)
+    {
+        _offsets.reserve(nodes_count + 1);
+    }
+
+    void add_node()
+    {
+        _offsets.push_back(_offsets.back());
+    }
+
+    void add_nodes(std::size_t count)
+    {
+        _offsets.resize(_offsets.size() + count, _offsets.back());
+    }
+
+    void freeze()
+    {
+        if(frozen())
+            return;
+
+        csr_detail::merge_pending(_offsets, _targets, _weights, _pending, directed());
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const weighted_csr& m)
+    {
+        for(std::size_t i = 0; i < m.nodes_count(); ++i)
+        {
+            os << "node " << i << ": ";
+
+            for(std::size_t k = m._offsets[i]; k < m._offsets[i + 1]; ++k)
+                os << "[" << m._targets[k] << "," << m._weights[k] << "] ";
+
+            os << "\n";
+        }
+
+        return os;
+    }
+
+private:
+    static constexpr std::size_t no_node_slot = std::numeric_limits<std::size_t>::max();
+
+    std::size_t _find(std::size_t i, std::size_t j) const
+    {
+        auto begin = _targets.begin() + _offsets[i], end = _targets.begin() + _offsets[i + 1];
+        auto it = std::lower_bound(begin, end, j);
+
+        return (it != end && *it == j) ? static_cast<std::size_t>(it - _targets.begin()) : no_node_slot;
+    }
+
+    struct node_proxy
+    {
+        node_proxy(weighted_csr* storage, std::size_t _i, std::size_t _j) :
+            _ref{storage},
+            i{_i},
+            j{_j}
+        {}
+
+        Weight operator=(Weight w)
+        {
+            _ref->add_edge(i, j, w);
+            return w;
+        }
+
+        operator bool() const
+        {
+            return static_cast<const weighted_csr&>(*_ref)(i, j);
+        }
+
+        weighted_csr* _ref;
+        std::size_t i, j;
+    };
+
+    std::vector<std::size_t> _offsets{0};
+    std::vector<std::size_t> _targets;
+    std::vector<Weight> _weights;
+    std::vector<csr_detail::pending_arc<Weight>> _pending;
+    bool _directed = false;
+};
+
+#endif //PRACTICA2MAR_WEIGHTED_STORAGE_HPP